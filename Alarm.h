@@ -0,0 +1,249 @@
+//-----------------------------------------------------------------------
+// Alarm.h - a scheduler for recurring alarms and chimes.
+// Copyright (c) 2017 Jim Thompson.
+
+//-----------------------------------------------------------------------
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef ALARM_H
+#define ALARM_H
+
+#include <Arduino.h>
+
+//-----------------------------------------------------------------------
+// Definitions:
+//
+// Second of the day - The number of seconds since local midnight,
+// 0 through 86399. This is the key the scheduler works with; the
+// clock hands it one second of the day per PPS tick.
+//
+// Alarm - A second of the day, a set of days of the week on which it
+// recurs, and an action number that is handed back to the owner when
+// the alarm goes off.
+//
+// Cursor - The index of the next alarm that is due today.
+//
+// The alarms are kept sorted by their second of the day. On an
+// ordinary tick the clock has advanced by exactly one second, so the
+// only alarm that can possibly be due is the one under the cursor;
+// we compare one number and we're done, no matter how many alarms
+// are registered. Only when the time jumps (the clock was set, or
+// this is the first tick after reset) do we search for a new cursor
+// position, and that's a binary search.
+//
+// Note that when the time jumps forward, any alarms in between are
+// skipped rather than fired all at once. That's what you'd want when
+// setting the clock with the dial.
+
+// Days of the week, as bits, for building recurrence masks. These
+// follow RTClib's dayOfTheWeek(), where Sunday is 0.
+const uint8_t ALARM_SUNDAY    = 0x01;
+const uint8_t ALARM_MONDAY    = 0x02;
+const uint8_t ALARM_TUESDAY   = 0x04;
+const uint8_t ALARM_WEDNESDAY = 0x08;
+const uint8_t ALARM_THURSDAY  = 0x10;
+const uint8_t ALARM_FRIDAY    = 0x20;
+const uint8_t ALARM_SATURDAY  = 0x40;
+
+const uint8_t ALARM_DAILY     = 0x7f;
+const uint8_t ALARM_WEEKDAYS  = 0x3e;
+const uint8_t ALARM_WEEKENDS  = 0x41;
+
+const uint32_t SECONDS_PER_DAY = 86400UL;
+
+// The most alarms we can hold. Each one costs six bytes of RAM, so
+// hundreds will fit on a Mega, though not on an Uno.
+#ifndef MAX_ALARMS
+#define MAX_ALARMS 32
+#endif
+
+static_assert((MAX_ALARMS > 0) && (MAX_ALARMS < 0xffff),
+              "MAX_ALARMS must fit the scheduler's 16-bit indices");
+
+// The function called when an alarm goes off. It receives the action
+// number the alarm was registered with.
+typedef void (*alarm_handler)(uint8_t action);
+
+class AlarmScheduler
+{
+  public:
+    // Public constructor
+    AlarmScheduler(alarm_handler h) // Called when an alarm goes off
+      : count(0),
+        cursor(0),
+        last_sod(SECONDS_PER_DAY),
+        handler(h)
+    {
+    }
+
+    // Register an alarm at the given second of the day, recurring on
+    // the days in the given mask. Returns false if the second of the
+    // day is out of range, the mask is empty, or there is no room.
+    bool add(uint32_t sod, uint8_t days, uint8_t action)
+    {
+      if ((sod >= SECONDS_PER_DAY) || ((days & ALARM_DAILY) == 0) ||
+          (count >= MAX_ALARMS))
+      {
+        return false;
+      }
+
+      // Insertion sort: slide later alarms up to make room. Alarms
+      // at the same second keep the order in which they were added.
+      uint16_t i = count;
+      while ((i > 0) && (alarms[i - 1].sod > sod))
+      {
+        alarms[i] = alarms[i - 1];
+        i--;
+      }
+
+      alarms[i].sod = sod;
+      alarms[i].days = days & ALARM_DAILY;
+      alarms[i].action = action;
+      count++;
+
+      // If the new alarm landed behind the cursor, the cursor has to
+      // move up one to keep pointing at the same alarm.
+      if (i < cursor)
+      {
+        cursor++;
+      }
+
+      return true;
+    }
+
+    // Remove every alarm at the given second of the day with the
+    // given action. Returns the number of alarms removed.
+    uint16_t remove(uint32_t sod, uint8_t action)
+    {
+      uint16_t removed = 0;
+      uint16_t j = 0;
+
+      for (uint16_t i = 0; i < count; i++)
+      {
+        if ((alarms[i].sod == sod) && (alarms[i].action == action))
+        {
+          if (i < cursor)
+          {
+            cursor--;
+          }
+          removed++;
+        }
+        else
+        {
+          alarms[j++] = alarms[i];
+        }
+      }
+
+      count = j;
+      return removed;
+    }
+
+    // Remove all alarms.
+    void clear()
+    {
+      count = 0;
+      cursor = 0;
+    }
+
+    // How many alarms are registered.
+    uint16_t size() const
+    {
+      return count;
+    }
+
+    // This function should be called once per second, with the
+    // current second of the day and day of the week. It calls the
+    // handler for each alarm that is due.
+    void tick(uint32_t sod, uint8_t weekday)
+    {
+      // A repeated second (e.g. a spurious PPS interrupt) must not
+      // fire anything twice.
+      if (sod == last_sod)
+      {
+        return;
+      }
+
+      // Work out what second we'd expect if the clock has simply
+      // advanced by one, allowing for the wrap at midnight.
+      uint32_t expected = last_sod + 1;
+      if (expected >= SECONDS_PER_DAY)
+      {
+        expected = 0;
+      }
+
+      // If the clock has jumped, find our place again. At midnight
+      // the cursor simply goes back to the start of the list.
+      if (sod != expected)
+      {
+        cursor = seek(sod);
+      }
+      else if (sod == 0)
+      {
+        cursor = 0;
+      }
+
+      last_sod = sod;
+
+      // Fire everything due at this second.
+      uint8_t day_bit = 1 << weekday;
+      while ((cursor < count) && (alarms[cursor].sod == sod))
+      {
+        if (alarms[cursor].days & day_bit)
+        {
+          handler(alarms[cursor].action);
+        }
+        cursor++;
+      }
+    }
+
+  private:
+    // Find the index of the first alarm at or after the given second
+    // of the day.
+    uint16_t seek(uint32_t sod) const
+    {
+      uint16_t lo = 0;
+      uint16_t hi = count;
+
+      while (lo < hi)
+      {
+        uint16_t mid = lo + (hi - lo) / 2;
+        if (alarms[mid].sod < sod)
+        {
+          lo = mid + 1;
+        }
+        else
+        {
+          hi = mid;
+        }
+      }
+
+      return lo;
+    }
+
+    struct Alarm
+    {
+      uint32_t sod;		// Second of the day the alarm goes off
+      uint8_t days;		// Days of the week it goes off on
+      uint8_t action;		// Passed to the handler
+    };
+
+    Alarm alarms[MAX_ALARMS];	// Registered alarms, sorted by sod
+    uint16_t count;		// Number of registered alarms
+    uint16_t cursor;		// Next alarm due today
+    uint32_t last_sod;		// The second of the day last seen
+
+    alarm_handler handler;	// Called when an alarm goes off
+};
+
+#endif
@@ -0,0 +1,116 @@
+//-----------------------------------------------------------------------
+// Boards.h - pin to port mappings for the boards we run on.
+// Copyright (c) 2017 Jim Thompson.
+
+//-----------------------------------------------------------------------
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef BOARDS_H
+#define BOARDS_H
+
+#include <Arduino.h>
+#include <avr/pgmspace.h>
+
+//-----------------------------------------------------------------------
+// The multiplexer writes its pins directly rather than through
+// digitalWrite, which is many times slower. For that it needs to know,
+// for each Arduino pin number, which port register the pin is in and
+// which bit of it. The table of these is a constexpr, so when the pin
+// number is a constant (as it always is in nixie.cpp) the compiler
+// looks it up while compiling and emits a single sbi/cbi, or a
+// load-modify-store for the ports above the I/O space; the table
+// itself takes no RAM at all. It's also placed in flash, so that
+// anything that really does have to pick a pin at run time can still
+// read it there with board_pin_port() and board_pin_mask().
+//
+// Ports are given by their data memory address, since the addresses
+// of the PORTx registers can't be taken in a constant expression.
+//
+// Which board's table we use is chosen by BOARD_TAG in the Makefile.
+
+struct board_pin
+{
+    uint16_t port;		// Data memory address of the PORT register
+    uint8_t mask;		// The pin's bit in it
+};
+
+#if defined(BOARD_TAG_uno)
+
+// Arduino Uno: pins 0-7 are PORTD (0x2B), 8-13 are PORTB (0x25).
+constexpr board_pin board_pins[] PROGMEM = {
+    {0x2B, 0x01}, {0x2B, 0x02}, {0x2B, 0x04}, {0x2B, 0x08},
+    {0x2B, 0x10}, {0x2B, 0x20}, {0x2B, 0x40}, {0x2B, 0x80},
+    {0x25, 0x01}, {0x25, 0x02}, {0x25, 0x04}, {0x25, 0x08},
+    {0x25, 0x10}, {0x25, 0x20},
+};
+
+#elif defined(BOARD_TAG_mega)
+
+// Arduino Mega 2560, pins 0-69 (A0-A15 are 54-69). Ports A to G are
+// in the I/O space; PORTH (0x102), PORTJ (0x105), PORTK (0x108) and
+// PORTL (0x10B) are above it, so pins on those take a load-modify-store
+// rather than a single sbi/cbi.
+constexpr board_pin board_pins[] PROGMEM = {
+    {0x2E, 0x01}, {0x2E, 0x02}, {0x2E, 0x10}, {0x2E, 0x20},
+    {0x34, 0x20}, {0x2E, 0x08}, {0x102, 0x08}, {0x102, 0x10},
+    {0x102, 0x20}, {0x102, 0x40}, {0x25, 0x10}, {0x25, 0x20},
+    {0x25, 0x40}, {0x25, 0x80}, {0x105, 0x02}, {0x105, 0x01},
+    {0x102, 0x02}, {0x102, 0x01}, {0x2B, 0x08}, {0x2B, 0x04},
+    {0x2B, 0x02}, {0x2B, 0x01}, {0x22, 0x01}, {0x22, 0x02},
+    {0x22, 0x04}, {0x22, 0x08}, {0x22, 0x10}, {0x22, 0x20},
+    {0x22, 0x40}, {0x22, 0x80}, {0x28, 0x80}, {0x28, 0x40},
+    {0x28, 0x20}, {0x28, 0x10}, {0x28, 0x08}, {0x28, 0x04},
+    {0x28, 0x02}, {0x28, 0x01}, {0x2B, 0x80}, {0x34, 0x04},
+    {0x34, 0x02}, {0x34, 0x01}, {0x10B, 0x80}, {0x10B, 0x40},
+    {0x10B, 0x20}, {0x10B, 0x10}, {0x10B, 0x08}, {0x10B, 0x04},
+    {0x10B, 0x02}, {0x10B, 0x01}, {0x25, 0x08}, {0x25, 0x04},
+    {0x25, 0x02}, {0x25, 0x01}, {0x31, 0x01}, {0x31, 0x02},
+    {0x31, 0x04}, {0x31, 0x08}, {0x31, 0x10}, {0x31, 0x20},
+    {0x31, 0x40}, {0x31, 0x80}, {0x108, 0x01}, {0x108, 0x02},
+    {0x108, 0x04}, {0x108, 0x08}, {0x108, 0x10}, {0x108, 0x20},
+    {0x108, 0x40}, {0x108, 0x80},
+};
+
+#else
+#error "No pin table for this board; set BOARD_TAG to uno or mega."
+#endif
+
+const uint8_t BOARD_PINS = sizeof(board_pins) / sizeof(board_pins[0]);
+
+// The host simulator defines this to point the port registers at its
+// own memory.
+#ifndef BOARD_PORT
+#define BOARD_PORT(address) (*(volatile uint8_t *) (address))
+#endif
+
+// Compile-time lookups. The pin number is a template parameter, so it
+// has to be a constant, and a pin the board doesn't have fails to
+// compile.
+template <uint8_t pin> constexpr uint16_t pin_port()
+{
+    static_assert(pin < BOARD_PINS, "pin not in this board's pin table");
+    return board_pins[pin].port;
+}
+
+template <uint8_t pin> constexpr uint8_t pin_mask()
+{
+    static_assert(pin < BOARD_PINS, "pin not in this board's pin table");
+    return board_pins[pin].mask;
+}
+
+// Run-time lookups, for when the pin number isn't known until then.
+inline uint16_t board_pin_port(uint8_t pin) { return pgm_read_word(&board_pins[pin].port); }
+inline uint8_t board_pin_mask(uint8_t pin) { return pgm_read_byte(&board_pins[pin].mask); }
+
+#endif
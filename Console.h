@@ -0,0 +1,88 @@
+//-----------------------------------------------------------------------
+// Console.h - serial command console.
+// Copyright (c) 2017 Jim Thompson.
+
+//-----------------------------------------------------------------------
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef CONSOLE_H
+#define CONSOLE_H
+
+#include <Arduino.h>
+
+//-----------------------------------------------------------------------
+// Commands are typed one per line at 115200 baud:
+//
+//   T hh:mm:ss      Set the time of day
+//   D yyyy-mm-dd    Set the date
+//   S               Print statistics
+//   C               List the stored settings (see Journal.h)
+//   C key value     Change a stored setting
+//   M               Print memory use (see Memory.h)
+//   O               Print how long each cathode has been lit since
+//                   reset, one line per tube and cathode: the tube,
+//                   the cathode, the multiplex slots it was lit for,
+//                   and the calls of nixie_parallel_cycle() it was lit
+//                   for on the parallel tubes
+//   t               Dump the trace ring (if tracing is compiled in)
+//   t mask          Trace only the sites whose bits are set (see Trace.h)
+//   t mask site n   The same, and freeze the ring n events after the
+//                   given site is next entered
+//
+// For scripts there's also a binary form, which sets any number of
+// stored settings at once. A frame is the byte 0xA5, a count n of up
+// to eight, n items of a key byte and a four-byte value (low byte
+// first), and a CRC-8 (CCITT, as in util/crc16.h) over the count and
+// the items. Key 0 sets the clock, in seconds since 1970; like D, it
+// only takes times from 2000 to 2099. The clock answers 0x06 if the
+// frame was good and applied, or 0x15 if not.
+//
+// console_poll() takes at most a few bytes from the serial receive
+// buffer on each call, so it can be called every time around the main
+// loop without holding up the multiplexing. A complete command is run
+// on the call after the one that finishes reading it.
+//
+// Nor does it ever wait for the transmit buffer, which only holds 64
+// bytes, less than most replies. A long reply is printed a piece at a
+// time by a console_reply function: the console calls it with 0, 1,
+// 2 and so on, one piece per call of console_poll() and only once
+// there's room for CONSOLE_PIECE_MAX bytes, until it returns false.
+// Nothing more is read until the reply is finished.
+
+extern void console_poll();
+
+const uint8_t CONSOLE_PIECE_MAX = 40;
+
+// Print the given piece of a reply, at most CONSOLE_PIECE_MAX bytes
+// of it. Returns false, having printed nothing, once there are no
+// more pieces.
+typedef bool (*console_reply)(uint16_t piece);
+
+// The longest any call to console_poll() has taken, in microseconds,
+// split into calls that only read and calls that ran a command.
+extern unsigned long console_read_max_us;
+extern unsigned long console_run_max_us;
+
+// The RAM taken by the console's variables, in bytes.
+extern uint16_t console_ram();
+
+// Things the console asks the rest of the clock to do.
+extern void clock_set_time(uint8_t h, uint8_t m, uint8_t s);
+extern void clock_set_date(uint16_t y, uint8_t m, uint8_t d);
+extern void clock_set(uint32_t t);
+extern bool clock_print_stats(uint16_t piece);
+extern bool clock_print_memory(uint16_t piece);
+extern bool clock_print_cathodes(uint16_t piece);
+
+#endif
@@ -41,7 +41,15 @@
 // Pulse - A transition from state 0 to state 1 and back to state 0
 // (after debouncing). Typically a pulse is about 100 ms. We do not
 // place strict requirements on a pulse except that we reject pulses
-// less than 30 ms.
+// less than half as long as the dial's usual break time (see below).
+//
+// Break time, make time and pulse period - How long the contacts stay
+// open during a pulse, how long they are closed between pulses, and
+// the sum of the two. A dial in good order runs at ten pulses per
+// second, with a break time of 60 ms and a make time of 40 ms, but
+// old dials run fast or slow. We measure the period and the break
+// time of each pulse and keep a running average of each, so we learn
+// the dial we're attached to.
 //
 // Debounce - When a switch is closed or opened, it does not go
 // cleanly from one state to the other; it bounces between states for
@@ -64,10 +72,29 @@
 // forward. We enter the Counting state when someone has released the
 // dial, so as to dial a single digit, at the moment we see the first
 // closing of the contacts.  We stay in this state, incrementing the
-// dial count each time we see a pulse, until a timeout occurs.
+// dial count each time we see a pulse, until a timeout occurs. The
+// timeout is the learned pulse period plus a margin for how much the
+// period varies from pulse to pulse, which we also measure: twice the
+// largest recent deviation, but never less than DIAL_MIN_MARGIN. A
+// large deviation widens the margin at once, and it narrows again
+// only slowly. So a steady dial finishes its digits soon after the
+// last pulse, and a ragged or slow one doesn't have its digits cut in
+// two.
 
 enum count_state { counting, waiting };
 
+// Limits on the learned pulse period, in milliseconds, and the period
+// we assume until we've learned anything: a dial in good order, at ten
+// pulses per second. The first pulse period we measure replaces it.
+// Until then the margin is wide enough for a dial as slow as eight
+// pulses per second; it shrinks as the dial shows how steady it is.
+const long DIAL_MIN_PERIOD = 60;
+const long DIAL_MAX_PERIOD = 160;
+const long DIAL_INITIAL_PERIOD = 100;
+const long DIAL_INITIAL_BREAK = 60;
+const long DIAL_INITIAL_MARGIN = 40;
+const long DIAL_MIN_MARGIN = 10;
+
 // Define some macros to make turning debug on and off easier.
 // For internal use only.
 
@@ -91,11 +118,31 @@ class RotaryDial
 				// timeout period
       : count(0),
         last_t1_time(0),
+        period(DIAL_INITIAL_PERIOD),
+        break_time(DIAL_INITIAL_BREAK),
+        spread(DIAL_INITIAL_MARGIN),
+        learned(false),
         state(waiting),
         b(pin, t)
     {
     }
 
+    // The learned pulse period, break time, and margin for the
+    // period's deviation, in milliseconds.
+    long pulse_period() const { return period; }
+    long pulse_break() const { return break_time; }
+    long pulse_spread() const { return spread; }
+
+    // Pulses shorter than this many milliseconds are rejected.
+    long min_pulse() const { return break_time / 2; }
+
+    // A digit is over when there has been no new pulse for this many
+    // milliseconds.
+    long dwell_timeout() const
+    {
+      return period + ((spread < DIAL_MIN_MARGIN) ? DIAL_MIN_MARGIN : spread);
+    }
+
     // This function should be called once each time through your main
     // event loop, a minimum of 100 times per secord or more. (Call it
     // at a lower rate, and you risk missing pulses).
@@ -169,13 +216,13 @@ class RotaryDial
             DPRINT("pulse width = ");
             DPRINTLN(pulse_time);
 
-	    // If the pulse width is less than 30 milliseconds, then
-	    // disregard the pulse; this can sometimes happen if one
-	    // forces the dial to turn faster than it ordinarily
-	    // would. It's reasonable in that circumstance to ignore
-	    // the pulse.
+	    // If the pulse width is less than half what this dial
+	    // usually gives, then disregard the pulse; this can
+	    // sometimes happen if one forces the dial to turn faster
+	    // than it ordinarily would. It's reasonable in that
+	    // circumstance to ignore the pulse.
 
-            if (pulse_time < 30)
+            if (pulse_time < min_pulse())
             {
               DPRINTLN("TOO SHORT! Ignoring...");
 
@@ -184,6 +231,11 @@ class RotaryDial
 	      // count).
               state = waiting;
             }
+            else
+            {
+	      // A good pulse; learn from it.
+              break_time += (pulse_time - break_time) / 4;
+            }
           }
 
 	  // If the new value is 1, then we're seeing the low-to-high
@@ -193,14 +245,44 @@ class RotaryDial
           {
             DPRINTLN("transition to one while counting");
     
-            // long now = millis();
-	    //            long cycle_time = now - last_t1_time;
+            long now = millis();
+            long cycle_time = now - last_t1_time;
             
             DPRINT("cycle width = ");
             DPRINTLN(cycle_time);
+
+	    // Learn the pulse period from this one, unless it's
+	    // wildly out (a bounce that got through, say). The first
+	    // one we see replaces the period we assumed.
+            if (!learned)
+            {
+              if ((cycle_time >= DIAL_MIN_PERIOD) && (cycle_time <= DIAL_MAX_PERIOD))
+              {
+                period = cycle_time;
+                learned = true;
+              }
+            }
+            else if ((cycle_time > period / 2) && (cycle_time < period * 2))
+            {
+              long deviation = cycle_time - period;
+              if (deviation < 0) deviation = -deviation;
+              if (deviation * 2 > spread)
+              {
+                spread = deviation * 2;
+              }
+              else
+              {
+                spread -= (spread - deviation * 2) / 16;
+              }
+
+              period += (cycle_time - period) / 4;
+
+              if (period < DIAL_MIN_PERIOD) period = DIAL_MIN_PERIOD;
+              if (period > DIAL_MAX_PERIOD) period = DIAL_MAX_PERIOD;
+            }
     
             count += 1;
-            last_t1_time = millis();
+            last_t1_time = now;
           }
         }
         else
@@ -211,10 +293,11 @@ class RotaryDial
           long now = millis();
           long dwell_time = now - last_t1_time;
 
-	  // In the Dialing state, if nothing has changed in 125 ms,
-	  // then we have timed out. Declare dialing done!
+	  // In the Dialing state, if nothing has changed for a
+	  // pulse period and a margin, then we have timed out.
+	  // Declare dialing done!
 
-          if (dwell_time > 125)
+          if (dwell_time > dwell_timeout())
           {
             DPRINT("Dwell time = ");
             DPRINTLN(dwell_time);
@@ -244,6 +327,11 @@ class RotaryDial
     int count;			// The number of pulses we have seen
     long last_t1_time;		// The last time we saw the contacts
 				// closed.
+    long period;		// Learned pulse period, in ms
+    long break_time;		// Learned break time, in ms
+    long spread;		// Margin for the period's deviation,
+				// in ms
+    bool learned;		// Whether the period has been measured yet
     count_state state;		// Current state - are we waiting or counting?
 
     Bounce b;			// The debouncer
@@ -0,0 +1,71 @@
+//-----------------------------------------------------------------------
+// Epoch.h - time of day and date kept as counters.
+// Copyright (c) 2017 Jim Thompson.
+
+//-----------------------------------------------------------------------
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef EPOCH_H
+#define EPOCH_H
+
+#include <Arduino.h>
+
+//-----------------------------------------------------------------------
+// The clock counts time as seconds since 1970 (the epoch), which is
+// what the RTC and the journal deal in. Turning that into a date and
+// time of day takes 32-bit divisions, which the AVR does in software,
+// so we don't do it every second: an epoch_time keeps the hours,
+// minutes, seconds and date alongside the count, and epoch_update()
+// just carries them forward when the time has moved on by a second,
+// as it nearly always has. Only a jump in the time (the clock being
+// set, or the RTC being found) needs the full conversion. The date is
+// only touched at midnight, from a table of month lengths. All of this
+// is checked against the host's gmtime() in host/epoch-test.cpp, and
+// timed against RTClib's DateTime in host/epoch-bench.cpp.
+//
+// Times run from 1970 to 2106, when 32 bits of seconds run out.
+
+const uint32_t EPOCH_SECONDS_PER_DAY = 86400UL;
+
+struct epoch_time
+{
+    uint32_t t;			// Seconds since 1970-01-01 00:00:00
+    uint32_t sod;		// Seconds since midnight
+    uint8_t hour;
+    uint8_t minute;
+    uint8_t second;
+    uint16_t year;
+    uint8_t month;		// 1 to 12
+    uint8_t day;		// 1 to 31
+    uint8_t weekday;		// 0 is Sunday, as in RTClib
+};
+
+// Set the time outright, working out the date and time of day from
+// scratch.
+extern void epoch_set(epoch_time &e, uint32_t t);
+
+// Move on by one second.
+extern void epoch_tick(epoch_time &e);
+
+// Bring the time up to t: a tick if it's the next second, otherwise
+// epoch_set().
+extern void epoch_update(epoch_time &e, uint32_t t);
+
+// The number of days in a month, 1 to 12, of a year.
+extern uint8_t epoch_days_in_month(uint16_t year, uint8_t month);
+
+// The epoch time of midnight at the start of a date.
+extern uint32_t epoch_from_date(uint16_t year, uint8_t month, uint8_t day);
+
+#endif
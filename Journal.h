@@ -0,0 +1,84 @@
+//-----------------------------------------------------------------------
+// Journal.h - settings and state kept in EEPROM across resets.
+// Copyright (c) 2017 Jim Thompson.
+
+//-----------------------------------------------------------------------
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <Arduino.h>
+
+//-----------------------------------------------------------------------
+// Each EEPROM cell is only good for about 100,000 writes, so we can't
+// simply keep each setting at a fixed address and write it whenever
+// it changes; the last displayed time alone would wear its cells out
+// in a couple of days. Instead the whole EEPROM is used as a ring of
+// small records, each holding one key, one value, a sequence number
+// and a CRC. A new value is always appended at the head of the ring,
+// so the writes are spread evenly over every cell. At startup one
+// scan of the ring finds the newest record for each key, and from
+// then on the values are looked up in RAM.
+//
+// Records that are still the newest for their key are never written
+// over: the head skips past them. So a setting that's written once
+// and never changed stays put however many times the ring wraps.
+//
+// Writes are rate limited per key, and only happen when the value has
+// changed. They're also done a byte at a time from journal_poll(), so
+// they never hold up the display: an EEPROM byte takes 3.3 ms to
+// program, which is several multiplex periods.
+
+// The keys we store. Zero is not used, so that an erased or zeroed
+// record can never look valid.
+enum journal_key
+{
+    JOURNAL_LAST_TIME = 1,	// The last time shown, in seconds since 1970
+    JOURNAL_TIMEZONE,		// Local time offset from UTC, in seconds
+    JOURNAL_TRANSITION,		// Digit transition style (see nixie.cpp)
+    JOURNAL_BANK_FRAMES,	// Frames out of 8 the second tube bank is lit
+    JOURNAL_KEYS
+};
+
+// Read the EEPROM and build the index. Call this once, before any of
+// the others.
+extern void journal_setup();
+
+// Get the latest value of a key. Returns false, leaving the value
+// alone, if the key has never been stored.
+extern bool journal_get(uint8_t key, int32_t &value);
+
+// Set the value of a key. This only changes the copy in RAM; the
+// value goes out to EEPROM later, from journal_poll().
+extern void journal_set(uint8_t key, int32_t value);
+
+// Write out changed values, a byte at a time. Call this often from
+// the main loop.
+extern void journal_poll();
+
+// Counters for working out write amplification: how many times a
+// value has actually changed, how many records have been written,
+// and how many EEPROM bytes have been programmed.
+extern uint32_t journal_changes;
+extern uint32_t journal_records;
+extern uint32_t journal_bytes;
+
+// The number of record slots in the ring.
+extern uint16_t journal_slots();
+
+// The RAM taken by the journal's variables, in bytes.
+extern uint16_t journal_ram();
+
+#endif
@@ -0,0 +1,168 @@
+//-----------------------------------------------------------------------
+// Memory.h - stack and free RAM instrumentation.
+// Copyright (c) 2017 Jim Thompson.
+
+//-----------------------------------------------------------------------
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef MEMORY_H
+#define MEMORY_H
+
+#include <Arduino.h>
+
+//-----------------------------------------------------------------------
+// The AVR has no memory protection: when the stack grows down into
+// the heap or the static variables, the clock just goes strange. To
+// see how close we come, every byte between the end of the static
+// variables and the top of RAM is painted with a known value at boot,
+// before the C runtime has touched the stack. The stack's high-water
+// mark is then wherever the paint stops. Type 'M' on the serial
+// console to see it, along with the free RAM and what each part of the
+// clock has allocated statically.
+//
+// We also keep the deepest the stack has gone inside isr() and
+// nixie_multiplex(), callees and any interrupts included. The
+// interrupt can come at any point in loop(), so its figure is the one
+// to watch. MEMORY_PROBE() at the top of a function paints the
+// MEMORY_PROBE_BYTES below the stack pointer, and when the function
+// returns it looks for the lowest of them that has been written. The
+// paint costs a few tens of microseconds, so the multiplexer is only
+// probed on one call in MEMORY_PROBE_MULTIPLEX. A depth of the full
+// MEMORY_PROBE_BYTES below where the function was entered means the
+// stack went at least that deep.
+//
+// Repainting would rub out the boot paint's record of where the stack
+// has been, so before it paints, a probe notes the lowest byte in its
+// patch that has already been written, in memory_probe_low, and the
+// high-water mark takes that into account. A probe is skipped when
+// the stack is within MEMORY_PROBE_BYTES of the heap, since its patch
+// would paint over the heap or the static variables; the high-water
+// mark still shows how close it came.
+
+// The value painted over free RAM. Anything but zero, which is what
+// most of the stack ends up holding. A pushed byte that happens to
+// equal it can hide, so the depths may read a byte or two short.
+const uint8_t MEMORY_PAINT = 0xc5;
+
+const uint8_t MEMORY_PROBE_BYTES = 64;
+const uint8_t MEMORY_PROBE_MULTIPLEX = 250;
+
+// The lowest stack pointers reached inside isr() and
+// nixie_multiplex(), and anywhere the probes have painted over.
+extern volatile uint16_t memory_isr_sp;
+extern volatile uint16_t memory_multiplex_sp;
+extern volatile uint16_t memory_probe_low;
+
+// Probe the stack depth from here to the end of the enclosing block,
+// on one call in every. This only means anything on the Arduino; the
+// host simulator compiles it out and measures its own way (see
+// host/flicker.cpp).
+#if defined(__AVR__)
+
+// The end of the static variables, where the heap starts, and the top
+// of the heap, which is zero until something has been allocated.
+extern uint8_t __heap_start;
+extern char *__brkval;
+
+// The first byte above the heap: everything from here up to the stack
+// pointer is free.
+inline uint8_t *memory_heap_end()
+{
+    return (__brkval == 0) ? &__heap_start : (uint8_t *) __brkval;
+}
+
+class MemoryProbe
+{
+  public:
+    __attribute__((always_inline)) MemoryProbe(volatile uint16_t &low, bool on)
+      : low(low), bottom(0)
+    {
+      if (on && ((uint8_t *) SP - memory_heap_end() >= MEMORY_PROBE_BYTES))
+      {
+	bottom = (uint8_t *) SP - MEMORY_PROBE_BYTES + 1;
+	uint16_t sp = lowest() - 1;
+
+	uint8_t sreg = SREG;
+	cli();
+	if (sp < memory_probe_low)
+	{
+	  memory_probe_low = sp;
+	}
+	SREG = sreg;
+
+	// Volatile, so the compiler can't turn the loop into a call to
+	// memset(), whose return address would be painted over.
+	volatile uint8_t *p = bottom;
+	while (p <= (uint8_t *) SP)
+	{
+	  *p++ = MEMORY_PAINT;
+	}
+      }
+    }
+
+    __attribute__((always_inline)) ~MemoryProbe()
+    {
+      if (bottom)
+      {
+	uint16_t sp = lowest() - 1;
+	if (sp < low)
+	{
+	  low = sp;
+	}
+      }
+    }
+
+  private:
+    // The lowest byte in the patch that isn't paint, or the one just
+    // above the patch if it's all paint. A push stores at the stack
+    // pointer and then moves it down, so the stack pointer got to one
+    // below this.
+    __attribute__((always_inline)) uint16_t lowest() const
+    {
+      volatile uint8_t *p = bottom;
+      while ((p < bottom + MEMORY_PROBE_BYTES) && (*p == MEMORY_PAINT))
+      {
+	p++;
+      }
+      return (uint16_t) (uintptr_t) p;
+    }
+
+    volatile uint16_t &low;
+    uint8_t *bottom;
+};
+
+#define MEMORY_PROBE(low, every)					\
+    static uint8_t memory_probe_calls = 0;				\
+    MemoryProbe memory_probe((low), (++memory_probe_calls % (every)) == 0)
+
+#else
+#define MEMORY_PROBE(low, every)
+#endif
+
+// The RAM taken by static variables, initialised or not.
+extern uint16_t memory_static();
+
+// The free RAM between the heap (or the static variables, if nothing
+// has been allocated) and the stack, right now.
+extern uint16_t memory_free();
+
+// The least free RAM there has ever been, from the paint.
+extern uint16_t memory_min_free();
+
+// Print the totals: static variables, heap, stack high-water, free RAM
+// and the sampled stack depths. This is a console_reply (see
+// Console.h), one line per piece.
+extern bool memory_report(uint16_t piece);
+
+#endif
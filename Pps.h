@@ -0,0 +1,273 @@
+//-----------------------------------------------------------------------
+// Pps.h - checking the PPS signal from the realtime clock, and
+// holding over when it stops.
+// Copyright (c) 2017 Jim Thompson.
+
+//-----------------------------------------------------------------------
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef PPS_H
+#define PPS_H
+
+#include <Arduino.h>
+
+//-----------------------------------------------------------------------
+// The PPS signal should arrive once a second, give or take the
+// jitter in micros() and in our interrupt latency. An edge that comes
+// more than PPS_WINDOW before it's due is a glitch (noise on the line,
+// or a bounce) and is thrown away. An edge that comes more than
+// PPS_WINDOW after it's due means we've missed one or more pulses; it
+// is taken as the signal coming back. When no edge has come for
+// PPS_WINDOW past when one was due, the signal is lost, and the clock
+// goes into holdover.
+//
+// Anything that restarts the DS3231's one second countdown - setting
+// its time, or finding it for the first time - moves its next edge to
+// some unpredictable point. Call rearm() then, so that the edge isn't
+// taken as a glitch or as missed pulses.
+//
+// edge() is called from the interrupt. Everything else reads what it
+// writes, so call the rest with interrupts off. It all takes the time
+// from micros() as an argument, so it can be tried out on the host
+// (see host/pps-test.cpp).
+
+const unsigned long PPS_PERIOD = 1000000;
+const unsigned long PPS_WINDOW = 50000;
+
+class PpsMonitor
+{
+  public:
+    PpsMonitor()
+      : glitches(0),
+        missed(0),
+        last_us(0),
+        seen(false)
+    {
+    }
+
+    // Check an edge that came at the given time. Returns true if it's
+    // good, false if it's a glitch.
+    bool edge(unsigned long now)
+    {
+      unsigned long elapsed = now - last_us;
+
+      if (seen)
+      {
+        if (elapsed < PPS_PERIOD - PPS_WINDOW)
+        {
+          glitches++;
+          return false;
+        }
+
+        if (elapsed > PPS_PERIOD + PPS_WINDOW)
+        {
+          missed += (elapsed + PPS_PERIOD / 2) / PPS_PERIOD - 1;
+        }
+      }
+
+      last_us = now;
+      seen = true;
+      return true;
+    }
+
+    // Take the next edge as good whenever it comes, and time the loss
+    // of the signal from now.
+    void rearm(unsigned long now)
+    {
+      last_us = now;
+      seen = false;
+    }
+
+    // Has the signal been lost? If so, late is set to how many
+    // microseconds ago the first missing edge was due.
+    bool lost(unsigned long now, unsigned long &late) const
+    {
+      unsigned long elapsed = now - last_us;
+
+      if (elapsed <= PPS_PERIOD + PPS_WINDOW)
+      {
+        return false;
+      }
+
+      late = elapsed - PPS_PERIOD;
+      return true;
+    }
+
+    // Edges rejected as glitches, and pulses that never came.
+    volatile uint16_t glitches;
+    volatile uint16_t missed;
+
+  private:
+    // The micros() time of the last good edge, and whether there's
+    // been one since we were armed.
+    volatile unsigned long last_us;
+    volatile bool seen;
+};
+
+//-----------------------------------------------------------------------
+// Where the time is coming from. We start out free running on the
+// Arduino's own clock, and switch to the realtime clock once it's been
+// found. If the PPS signal stops while we're running from the RTC we
+// go into holdover, keeping time on the Arduino's clock from the last
+// good pulse, until it comes back.
+//
+// While running from the RTC, a pulse just moves the time on by a
+// second. Reading the time from the RTC takes an I2C transfer and
+// RTClib's DateTime conversion, so that's only done on the first pulse
+// after it's found, after it's set, after a pulse is missed or the
+// signal comes back from holdover, and otherwise every
+// CLOCK_RESYNC_INTERVAL pulses.
+//
+// Like PpsMonitor, everything takes the time as an argument, so that
+// host/pps-test.cpp can drive it, and everything is called with
+// interrupts off, since it reads what edge() writes.
+
+enum clock_source { free_running, realtime_clock, holdover };
+
+// What poll() found.
+enum clock_event
+{
+  CLOCK_WAIT,			// Nothing yet
+  CLOCK_TICK,			// A second is due on the Arduino's clock
+  CLOCK_LOST			// The PPS signal has just been lost
+};
+
+// What to do with the time when a second comes.
+enum clock_step
+{
+  CLOCK_STAY,			// Nothing
+  CLOCK_COUNT,			// Move it on by a second
+  CLOCK_READ			// Read it from the RTC
+};
+
+const uint16_t CLOCK_RESYNC_INTERVAL = 3600;
+
+class ClockSource
+{
+  public:
+    ClockSource()
+      : source(free_running),
+        holdovers(0),
+        tick_ms(0),
+        resync_in(0),
+        missed_seen(0)
+    {
+    }
+
+    // Start free running, with the first second a second from now.
+    void start(unsigned long now_ms)
+    {
+      tick_ms = now_ms + 1000;
+    }
+
+    // The RTC has been found. The first pulse can come at any time, so
+    // it isn't checked against the time now, and the RTC is read on it.
+    void found(unsigned long now_us)
+    {
+      pps.rearm(now_us);
+      source = realtime_clock;
+      resync_in = 0;
+    }
+
+    // The RTC has been set. That restarts its countdown to the next
+    // pulse, so we can't tell whether that pulse starts the second we
+    // set or the one after; read it back then.
+    void set(unsigned long now_us)
+    {
+      if (source != free_running)
+      {
+        pps.rearm(now_us);
+        resync_in = 0;
+      }
+    }
+
+    // Call this while waiting for a pulse.
+    clock_event poll(unsigned long now_us, unsigned long now_ms)
+    {
+      if (source == realtime_clock)
+      {
+        unsigned long late;
+        if (!pps.lost(now_us, late))
+        {
+          return CLOCK_WAIT;
+        }
+
+        // Carry on from the last pulse. The second it should have
+        // ticked is already due, so the next poll() ticks it.
+        source = holdover;
+        holdovers++;
+        tick_ms = now_ms - late / 1000;
+        return CLOCK_LOST;
+      }
+
+      if ((long) (now_ms - tick_ms) >= 0)
+      {
+        tick_ms += 1000;
+        return CLOCK_TICK;
+      }
+      return CLOCK_WAIT;
+    }
+
+    // Call this when a pulse has come (pulse), or poll() has ticked
+    // (tick), or both.
+    clock_step step(bool pulse, bool tick)
+    {
+      // A pulse during holdover means the PPS signal is back.
+      if (pulse && (source == holdover))
+      {
+        source = realtime_clock;
+        resync_in = 0;
+      }
+
+      if (source != realtime_clock)
+      {
+        return tick ? CLOCK_COUNT : CLOCK_STAY;
+      }
+
+      if (!pulse)
+      {
+        return CLOCK_STAY;
+      }
+
+      if ((resync_in == 0) || (pps.missed != missed_seen))
+      {
+        resync_in = CLOCK_RESYNC_INTERVAL;
+        missed_seen = pps.missed;
+        return CLOCK_READ;
+      }
+
+      resync_in--;
+      return CLOCK_COUNT;
+    }
+
+    // The checks on the pulses; the interrupt calls pps.edge().
+    PpsMonitor pps;
+
+    clock_source source;
+
+    // How many times we've gone into holdover.
+    uint16_t holdovers;
+
+  private:
+    // The millis() time of the next second on the Arduino's clock,
+    // while free running or in holdover.
+    unsigned long tick_ms;
+
+    // Pulses until the next read of the RTC (zero when one is due),
+    // and the count of missed pulses at the last read.
+    uint16_t resync_in;
+    uint16_t missed_seen;
+};
+
+#endif
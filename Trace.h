@@ -0,0 +1,166 @@
+//-----------------------------------------------------------------------
+// Trace.h - cheap timestamped trace points for timing work.
+// Copyright (c) 2017 Jim Thompson.
+
+//-----------------------------------------------------------------------
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef TRACE_H
+#define TRACE_H
+
+#include <Arduino.h>
+
+//-----------------------------------------------------------------------
+// Serial.print is far too slow to time anything in the main loop, and
+// toggling the LED only tells you about one thing at a time. Instead,
+// TRACE_ENTER() and TRACE_EXIT() record an event number and the value
+// of Timer1 into a ring buffer in RAM, which takes a couple of dozen
+// cycles. Type 't' on the serial console and the ring is printed out;
+// host/trace-report.cpp turns that into latency histograms and a
+// timeline for chrome://tracing.
+//
+// Timer1 is run freely at the CPU clock, so each count is one cycle
+// (62.5 ns at 16 MHz). It wraps every 4.096 ms, so its overflow
+// interrupt counts the wraps, and each event records the low byte of
+// that count too; that's enough for the host tool to unwrap gaps of up
+// to a second, such as a console command printing its reply. Taking
+// over Timer1 means no PWM on the pins it drives (11 and 12 on the
+// Mega), which we only use as plain outputs anyway.
+//
+// Some sites fire far more often than others: dial.cycle() is called
+// every few tens of microseconds, and would fill the ring in a couple
+// of milliseconds. So each site can be switched on or off with
+// trace_mask, and dial.cycle() is off to begin with. The ring can also
+// be made to freeze a given number of events after a chosen site is
+// entered, to catch what happens around a rare event such as a
+// dialed digit. Both are set from the console (see Console.h).
+//
+// Tracing is compiled in only when TRACE_ENABLE is set; otherwise the
+// macros compile to nothing and the ring takes no RAM. It has to be
+// set for every file at once, so turn it on in the Makefile.
+
+#ifndef TRACE_ENABLE
+#define TRACE_ENABLE 0
+#endif
+
+// The places we trace. Each has an enter and an exit event; the event
+// number is twice the site number, plus one for exit. If you add a
+// site here, add its name to host/trace-report.cpp too.
+enum trace_site
+{
+    TRACE_MULTIPLEX,		// nixie_multiplex()
+    TRACE_ISR,			// isr()
+    TRACE_RTC_NOW,		// rtc.now()
+    TRACE_DIAL_CYCLE,		// dial.cycle()
+    TRACE_DIALED_DIGIT,		// handle_dialed_digit()
+};
+
+#if TRACE_ENABLE
+
+// The number of events the ring holds. Must be a power of two. Each
+// event takes four bytes.
+#ifndef TRACE_SIZE
+#define TRACE_SIZE 128
+#endif
+
+struct trace_event
+{
+    uint8_t id;			// Site number times two, plus one for exit
+    uint8_t wraps;		// Timer1 overflows, low byte
+    uint16_t stamp;		// Timer1 count
+};
+
+// The sites traced when the clock starts: everything but dial.cycle().
+const uint8_t TRACE_DEFAULT_MASK = 0xff & ~(1 << TRACE_DIAL_CYCLE);
+
+// No trigger site.
+const uint8_t TRACE_NO_TRIGGER = 0xff;
+
+extern trace_event trace_ring[TRACE_SIZE];
+extern volatile uint8_t trace_head;
+extern volatile bool trace_frozen;
+extern volatile uint8_t trace_wraps;
+
+// Which sites are traced, one bit per site.
+extern volatile uint8_t trace_mask;
+
+// The site whose entry starts the countdown to freezing the ring, how
+// many events to record after it, and how many are still to come (zero
+// when the countdown hasn't started).
+extern volatile uint8_t trace_trigger;
+extern volatile uint8_t trace_after;
+extern volatile uint8_t trace_countdown;
+
+extern void trace_setup();
+
+// Print the ring, as a console_reply (see Console.h).
+extern bool trace_dump(uint16_t piece);
+
+// Record one event. Interrupts are held off just long enough to claim
+// a slot, so this can be used from ISRs and the main loop alike.
+__attribute__((always_inline)) inline void trace_record(uint8_t site, uint8_t id)
+{
+    if (!(trace_mask & (1 << site)))
+    {
+	return;
+    }
+
+    uint8_t sreg = SREG;
+    cli();
+
+    if (!trace_frozen)
+    {
+	uint16_t stamp = TCNT1;
+	uint8_t wraps = trace_wraps;
+
+	// Timer1 may have wrapped since interrupts went off, without the
+	// overflow interrupt having counted it yet.
+	if ((TIFR1 & _BV(TOV1)) && (stamp < 0x8000))
+	{
+	    wraps++;
+	}
+
+	uint8_t h = trace_head;
+	trace_ring[h].id = id;
+	trace_ring[h].wraps = wraps;
+	trace_ring[h].stamp = stamp;
+	trace_head = (h + 1) & (TRACE_SIZE - 1);
+
+	if (trace_countdown != 0)
+	{
+	    if (--trace_countdown == 0)
+	    {
+		trace_frozen = true;
+	    }
+	}
+	else if ((site == trace_trigger) && !(id & 1))
+	{
+	    trace_countdown = trace_after;
+	}
+    }
+
+    SREG = sreg;
+}
+
+#define TRACE_ENTER(site) trace_record((site), (site) << 1)
+#define TRACE_EXIT(site) trace_record((site), ((site) << 1) | 1)
+
+#else
+
+#define TRACE_ENTER(site)
+#define TRACE_EXIT(site)
+
+#endif
+
+#endif
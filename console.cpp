@@ -0,0 +1,500 @@
+//-----------------------------------------------------------------------
+// console.cpp - Serial command console.
+
+// Copyright (c) 2017 Jim Thompson.
+
+//-----------------------------------------------------------------------
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <Arduino.h>
+#include <util/crc16.h>
+#include "Console.h"
+#include "Epoch.h"
+#include "Journal.h"
+#include "Trace.h"
+
+// How many bytes to take from the receive buffer per call. At 115200
+// baud a byte arrives every 87 us, so four per call keeps up easily
+// at the rate loop() goes round.
+const uint8_t BYTES_PER_CALL = 4;
+
+// The longest command line we accept. Anything longer is thrown away.
+const uint8_t LINE_MAX = 24;
+
+// Framing for binary mode.
+const uint8_t BINARY_START = 0xA5;
+const uint8_t BINARY_ACK = 0x06;
+const uint8_t BINARY_NAK = 0x15;
+const uint8_t BINARY_MAX_ITEMS = 8;
+const uint8_t BINARY_ITEM_SIZE = 5;
+
+// A binary frame that stops arriving part way through is abandoned
+// after this many milliseconds.
+const unsigned long BINARY_TIMEOUT = 100;
+
+// The times the clock can be set to: the years 2000 to 2099, which is
+// all the RTC (and RTClib's DateTime) can hold.
+const uint32_t TIME_MIN = 946684800UL;	// 2000-01-01 00:00:00
+const uint32_t TIME_MAX = 4102444799UL;	// 2099-12-31 23:59:59
+
+// The names of the stored settings, for listing them. These follow
+// enum journal_key.
+static const char *setting_names[JOURNAL_KEYS] = {
+    "",
+    "last_time",
+    "timezone",
+    "transition",
+    "bank_frames",
+};
+
+// Where we are in reading a command.
+enum console_state
+{
+    reading_text,		// Reading a line of text
+    reading_count,		// Reading a binary frame's item count
+    reading_items,		// Reading a binary frame's items
+    reading_crc,		// Reading a binary frame's CRC
+    text_ready,			// A line is waiting to be run
+    binary_ready,		// A binary frame is waiting to be run
+    replying,			// Printing a long reply
+};
+
+static console_state state = reading_text;
+
+// The line being read, and whether it has overflowed.
+static char line[LINE_MAX + 1];
+static uint8_t line_length = 0;
+static bool line_overflow = false;
+
+// The binary frame being read.
+static uint8_t items[BINARY_MAX_ITEMS * BINARY_ITEM_SIZE];
+static uint8_t item_count = 0;
+static uint8_t item_bytes = 0;
+static uint8_t frame_crc = 0;
+static unsigned long frame_ms = 0;
+
+// The reply being printed, and its next piece.
+static console_reply reply = 0;
+static uint16_t reply_piece = 0;
+
+unsigned long console_read_max_us = 0;
+unsigned long console_run_max_us = 0;
+
+uint16_t console_ram()
+{
+    // The setting names aren't in PROGMEM, so they and the pointers
+    // to them take RAM too.
+    uint16_t names = sizeof(setting_names);
+    for (uint8_t key = 0; key < JOURNAL_KEYS; key++)
+    {
+	names += strlen(setting_names[key]) + 1;
+    }
+
+    return names + sizeof(state) + sizeof(line) + sizeof(line_length) +
+	sizeof(line_overflow) + sizeof(items) + sizeof(item_count) +
+	sizeof(item_bytes) + sizeof(frame_crc) + sizeof(frame_ms) +
+	sizeof(reply) + sizeof(reply_piece) +
+	sizeof(console_read_max_us) + sizeof(console_run_max_us);
+}
+
+// Take one byte of input. Returns true if it completes a command.
+static bool take(uint8_t c)
+{
+    switch(state)
+    {
+    case reading_text:
+	// A binary frame can only start at the beginning of a line.
+	if ((c == BINARY_START) && (line_length == 0) && !line_overflow)
+	{
+	    state = reading_count;
+	    frame_crc = 0;
+	    frame_ms = millis();
+	    return false;
+	}
+
+	if ((c == '\r') || (c == '\n'))
+	{
+	    // Ignore blank lines (and the other half of a CR LF).
+	    if ((line_length == 0) && !line_overflow)
+	    {
+		return false;
+	    }
+
+	    line[line_length] = 0;
+	    state = text_ready;
+	    return true;
+	}
+
+	if (line_length < LINE_MAX)
+	{
+	    line[line_length++] = c;
+	}
+	else
+	{
+	    line_overflow = true;
+	}
+	return false;
+
+    case reading_count:
+	if ((c == 0) || (c > BINARY_MAX_ITEMS))
+	{
+	    Serial.write(BINARY_NAK);
+	    state = reading_text;
+	    return false;
+	}
+
+	item_count = c;
+	item_bytes = 0;
+	frame_crc = _crc8_ccitt_update(frame_crc, c);
+	state = reading_items;
+	return false;
+
+    case reading_items:
+	items[item_bytes++] = c;
+	frame_crc = _crc8_ccitt_update(frame_crc, c);
+	if (item_bytes == item_count * BINARY_ITEM_SIZE)
+	{
+	    state = reading_crc;
+	}
+	return false;
+
+    case reading_crc:
+	if (c != frame_crc)
+	{
+	    Serial.write(BINARY_NAK);
+	    state = reading_text;
+	    return false;
+	}
+
+	state = binary_ready;
+	return true;
+
+    default:
+	return false;
+    }
+}
+
+// Read a number, possibly negative, skipping leading spaces. Returns
+// false if there isn't one.
+static bool number(const char *&p, int32_t &value)
+{
+    while (*p == ' ')
+    {
+	p++;
+    }
+
+    bool negative = false;
+    if (*p == '-')
+    {
+	negative = true;
+	p++;
+    }
+
+    if ((*p < '0') || (*p > '9'))
+    {
+	return false;
+    }
+
+    int32_t v = 0;
+    while ((*p >= '0') && (*p <= '9'))
+    {
+	v = v * 10 + (*p++ - '0');
+    }
+
+    value = negative ? -v : v;
+    return true;
+}
+
+// Step over the expected separator character. Returns false if it
+// isn't there.
+static bool separator(const char *&p, char c)
+{
+    if (*p != c)
+    {
+	return false;
+    }
+
+    p++;
+    return true;
+}
+
+// Is there nothing but spaces left?
+static bool end(const char *p)
+{
+    while (*p == ' ')
+    {
+	p++;
+    }
+
+    return *p == 0;
+}
+
+// List the stored settings, one per piece.
+static bool list_settings(uint16_t piece)
+{
+    uint8_t key = piece + 1;
+    if (key >= JOURNAL_KEYS)
+    {
+	return false;
+    }
+
+    int32_t value;
+
+    Serial.print(key);
+    Serial.print(' ');
+    Serial.print(setting_names[key]);
+    Serial.print(' ');
+    if (journal_get(key, value))
+    {
+	Serial.println(value);
+    }
+    else
+    {
+	Serial.println("-");
+    }
+    return true;
+}
+
+// Start printing a long reply, from the next call of console_poll().
+static void start_reply(console_reply r)
+{
+    reply = r;
+    reply_piece = 0;
+    state = replying;
+}
+
+// Run a line of text.
+static void run_line()
+{
+    const char *p = line + 1;
+    int32_t a, b, c;
+    bool ok = false;
+
+    if (line_overflow)
+    {
+	Serial.println("Line too long");
+	return;
+    }
+
+    switch(line[0])
+    {
+    case 'T':
+	if (number(p, a) && separator(p, ':') && number(p, b) &&
+	    separator(p, ':') && number(p, c) && end(p) &&
+	    (a >= 0) && (a < 24) && (b >= 0) && (b < 60) && (c >= 0) && (c < 60))
+	{
+	    clock_set_time(a, b, c);
+	    ok = true;
+	}
+	break;
+
+    case 'D':
+	if (number(p, a) && separator(p, '-') && number(p, b) &&
+	    separator(p, '-') && number(p, c) && end(p) &&
+	    (a >= 2000) && (a < 2100) && (b >= 1) && (b <= 12) &&
+	    (c >= 1) && (c <= epoch_days_in_month(a, b)))
+	{
+	    clock_set_date(a, b, c);
+	    ok = true;
+	}
+	break;
+
+    case 'S':
+	if (end(p))
+	{
+	    start_reply(clock_print_stats);
+	    return;
+	}
+	break;
+
+    case 'M':
+	if (end(p))
+	{
+	    start_reply(clock_print_memory);
+	    return;
+	}
+	break;
+
+    case 'O':
+	if (end(p))
+	{
+	    start_reply(clock_print_cathodes);
+	    return;
+	}
+	break;
+
+    case 'C':
+	if (end(p))
+	{
+	    start_reply(list_settings);
+	    return;
+	}
+
+	if (number(p, a) && number(p, b) && end(p) &&
+	    (a > 0) && (a < JOURNAL_KEYS))
+	{
+	    journal_set(a, b);
+	    ok = true;
+	}
+	break;
+
+#if TRACE_ENABLE
+    case 't':
+	if (end(p))
+	{
+	    start_reply(trace_dump);
+	    return;
+	}
+
+	if (number(p, a) && (a >= 0) && (a <= 0xff))
+	{
+	    if (end(p))
+	    {
+		trace_mask = a;
+		trace_trigger = TRACE_NO_TRIGGER;
+		ok = true;
+	    }
+	    else if (number(p, b) && number(p, c) && end(p) &&
+		     (b >= 0) && (b < 8) && (c > 0) && (c <= 0xff))
+	    {
+		noInterrupts();
+		trace_mask = a;
+		trace_trigger = b;
+		trace_after = c;
+		trace_countdown = 0;
+		trace_frozen = false;
+		interrupts();
+		ok = true;
+	    }
+	}
+	break;
+#endif
+    }
+
+    Serial.println(ok ? "OK" : "Error");
+}
+
+// The value of one item of a binary frame.
+static uint32_t item_value(uint8_t i)
+{
+    const uint8_t *item = items + i * BINARY_ITEM_SIZE;
+    return (uint32_t) item[1] | ((uint32_t) item[2] << 8) |
+	((uint32_t) item[3] << 16) | ((uint32_t) item[4] << 24);
+}
+
+// Run a binary frame. Every item is checked before any is applied, so
+// a bad frame changes nothing.
+static void run_binary()
+{
+    for (uint8_t i = 0; i < item_count; i++)
+    {
+	uint8_t key = items[i * BINARY_ITEM_SIZE];
+	uint32_t value = item_value(i);
+
+	if ((key >= JOURNAL_KEYS) ||
+	    ((key == 0) && ((value < TIME_MIN) || (value > TIME_MAX))))
+	{
+	    Serial.write(BINARY_NAK);
+	    return;
+	}
+    }
+
+    for (uint8_t i = 0; i < item_count; i++)
+    {
+	const uint8_t *item = items + i * BINARY_ITEM_SIZE;
+	uint32_t value = item_value(i);
+
+	if (item[0] == 0)
+	{
+	    clock_set(value);
+	}
+	else
+	{
+	    journal_set(item[0], (int32_t) value);
+	}
+    }
+
+    Serial.write(BINARY_ACK);
+}
+
+void console_poll()
+{
+    // Run any command that was completed last time, or print the next
+    // piece of a reply, but only if it won't have to wait for the
+    // transmit buffer.
+    if ((state == text_ready) || (state == binary_ready) || (state == replying))
+    {
+	if (Serial.availableForWrite() < CONSOLE_PIECE_MAX)
+	{
+	    return;
+	}
+
+	unsigned long start = micros();
+
+	if (state == replying)
+	{
+	    if (!reply(reply_piece++))
+	    {
+		state = reading_text;
+	    }
+	}
+	else
+	{
+	    console_state ready = state;
+	    state = reading_text;
+
+	    if (ready == text_ready)
+	    {
+		run_line();
+	    }
+	    else
+	    {
+		run_binary();
+	    }
+
+	    line_length = 0;
+	    line_overflow = false;
+	}
+
+	unsigned long us = micros() - start;
+	if (us > console_run_max_us)
+	{
+	    console_run_max_us = us;
+	}
+	return;
+    }
+
+    unsigned long start = micros();
+
+    // Give up on a binary frame that has stalled.
+    if ((state != reading_text) && ((millis() - frame_ms) > BINARY_TIMEOUT))
+    {
+	Serial.write(BINARY_NAK);
+	state = reading_text;
+    }
+
+    for (uint8_t i = 0; (i < BYTES_PER_CALL) && Serial.available(); i++)
+    {
+	if (take(Serial.read()))
+	{
+	    break;
+	}
+    }
+
+    unsigned long us = micros() - start;
+    if (us > console_read_max_us)
+    {
+	console_read_max_us = us;
+    }
+}
@@ -0,0 +1,171 @@
+//-----------------------------------------------------------------------
+// epoch.cpp - Date and time of day from seconds since 1970.
+
+// Copyright (c) 2017 Jim Thompson.
+
+//-----------------------------------------------------------------------
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <Arduino.h>
+#include <avr/pgmspace.h>
+#include "Epoch.h"
+
+// The length of each month, and the number of days in the year before
+// it starts, in a year that isn't a leap year.
+static const uint8_t month_days[12] PROGMEM = {
+    31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30, 31,
+};
+
+static const uint16_t month_start[12] PROGMEM = {
+    0, 31, 59, 90, 120, 151, 181, 212, 243, 273, 304, 334,
+};
+
+// 1970-01-01 was a Thursday.
+const uint8_t EPOCH_WEEKDAY = 4;
+
+static bool leap(uint16_t year)
+{
+    return ((year % 4) == 0) && (((year % 100) != 0) || ((year % 400) == 0));
+}
+
+uint8_t epoch_days_in_month(uint16_t year, uint8_t month)
+{
+    uint8_t days = pgm_read_byte(&month_days[month - 1]);
+    return ((month == 2) && leap(year)) ? days + 1 : days;
+}
+
+// Leap years from 1970 up to, but not including, the given year.
+static uint16_t leaps_before(uint16_t year)
+{
+    uint16_t y = year - 1;
+    return (y / 4 - 1969 / 4) - (y / 100 - 1969 / 100) + (y / 400 - 1969 / 400);
+}
+
+void epoch_set(epoch_time &e, uint32_t t)
+{
+    uint16_t days = t / EPOCH_SECONDS_PER_DAY;
+
+    e.t = t;
+    e.sod = t - days * EPOCH_SECONDS_PER_DAY;
+
+    uint16_t minutes = e.sod / 60;
+    e.second = e.sod - minutes * 60UL;
+    e.hour = minutes / 60;
+    e.minute = minutes - e.hour * 60;
+
+    e.weekday = (days + EPOCH_WEEKDAY) % 7;
+
+    // Step through the years; there are at most 136 of them. Then
+    // look the month up in the table.
+    uint16_t year = 1970;
+    for (;;)
+    {
+	uint16_t length = leap(year) ? 366 : 365;
+	if (days < length)
+	{
+	    break;
+	}
+	days -= length;
+	year++;
+    }
+
+    uint8_t month = 12;
+    while (month > 1)
+    {
+	uint16_t start = pgm_read_word(&month_start[month - 1]);
+	if ((month > 2) && leap(year))
+	{
+	    start++;
+	}
+	if (days >= start)
+	{
+	    days -= start;
+	    break;
+	}
+	month--;
+    }
+
+    e.year = year;
+    e.month = month;
+    e.day = days + 1;
+}
+
+void epoch_tick(epoch_time &e)
+{
+    e.t++;
+    e.sod++;
+
+    if (++e.second < 60)
+    {
+	return;
+    }
+    e.second = 0;
+
+    if (++e.minute < 60)
+    {
+	return;
+    }
+    e.minute = 0;
+
+    if (++e.hour < 24)
+    {
+	return;
+    }
+    e.hour = 0;
+    e.sod = 0;
+
+    // Midnight: on to the next day.
+    if (++e.weekday == 7)
+    {
+	e.weekday = 0;
+    }
+
+    if (++e.day <= epoch_days_in_month(e.year, e.month))
+    {
+	return;
+    }
+    e.day = 1;
+
+    if (++e.month <= 12)
+    {
+	return;
+    }
+    e.month = 1;
+    e.year++;
+}
+
+void epoch_update(epoch_time &e, uint32_t t)
+{
+    if (t == e.t + 1)
+    {
+	epoch_tick(e);
+    }
+    else if (t != e.t)
+    {
+	epoch_set(e, t);
+    }
+}
+
+uint32_t epoch_from_date(uint16_t year, uint8_t month, uint8_t day)
+{
+    uint16_t days = (year - 1970) * 365U + leaps_before(year) +
+	pgm_read_word(&month_start[month - 1]) + (day - 1);
+
+    if ((month > 2) && leap(year))
+    {
+	days++;
+    }
+
+    return days * EPOCH_SECONDS_PER_DAY;
+}
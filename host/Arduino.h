@@ -0,0 +1,118 @@
+//-----------------------------------------------------------------------
+// Arduino.h - just enough of the Arduino environment to build the
+// clock on the host, for the simulator in host/flicker.cpp and the
+// other host tools.
+
+// Copyright (c) 2017 Jim Thompson.
+
+//-----------------------------------------------------------------------
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#ifndef HOST_ARDUINO_H
+#define HOST_ARDUINO_H
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+typedef uint8_t byte;
+
+#define LOW 0
+#define HIGH 1
+#define INPUT 0
+#define OUTPUT 1
+#define INPUT_PULLUP 2
+#define RISING 3
+
+#define constrain(amt, low, high) ((amt) < (low) ? (low) : ((amt) > (high) ? (high) : (amt)))
+
+// The I/O registers are plain bytes of memory, at the same addresses
+// as on the Arduino (see Boards.h). The simulator reads them back to
+// see what the pins are doing.
+extern volatile uint8_t host_memory[0x200];
+#define BOARD_PORT(address) (host_memory[address])
+
+// Simulated time.
+extern unsigned long micros();
+extern unsigned long millis();
+
+// Pin setup is done directly on the ports in the code we simulate,
+// so this doesn't need to do anything.
+inline void pinMode(uint8_t, uint8_t) {}
+
+// Everything else is up to the host tool that uses it: what the input
+// pins read, what a write to an output pin costs, and when the
+// interrupts come.
+extern int digitalRead(uint8_t pin);
+extern void digitalWrite(uint8_t pin, uint8_t value);
+extern void attachInterrupt(uint8_t interrupt, void (*isr)(), int mode);
+extern void noInterrupts();
+extern void interrupts();
+
+inline uint8_t digitalPinToInterrupt(uint8_t pin)
+{
+    return pin;
+}
+
+// The serial port. The host tool supplies the four calls that move
+// bytes; printing is done here, in terms of write().
+class HardwareSerial
+{
+  public:
+    void begin(unsigned long) {}
+    int available();
+    int read();
+    int availableForWrite();
+    size_t write(uint8_t c);
+
+    size_t print(const char *s)
+    {
+	size_t n = 0;
+	while (*s)
+	{
+	    n += write(*s++);
+	}
+	return n;
+    }
+
+    size_t print(char c) { return write(c); }
+    size_t print(int v) { return print((long) v); }
+    size_t print(unsigned int v) { return print((unsigned long) v); }
+
+    size_t print(long v)
+    {
+	char text[12];
+	snprintf(text, sizeof(text), "%ld", v);
+	return print(text);
+    }
+
+    size_t print(unsigned long v)
+    {
+	char text[12];
+	snprintf(text, sizeof(text), "%lu", v);
+	return print(text);
+    }
+
+    size_t println() { return write('\r') + write('\n'); }
+
+    template <typename T> size_t println(T v)
+    {
+	size_t n = print(v);
+	return n + println();
+    }
+};
+
+extern HardwareSerial Serial;
+
+#endif
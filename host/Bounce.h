@@ -0,0 +1,41 @@
+//-----------------------------------------------------------------------
+// Bounce.h - The debouncer from the original Bounce library, for the
+// host build. A change of the pin is taken at once, unless the last
+// change taken was less than the interval ago; then it waits.
+
+#ifndef HOST_BOUNCE_H
+#define HOST_BOUNCE_H
+
+#include <Arduino.h>
+
+class Bounce
+{
+  public:
+    Bounce(uint8_t pin, unsigned long interval)
+      : pin(pin), interval(interval), previous(millis()), state(digitalRead(pin))
+    {
+    }
+
+    // Returns 1 if the debounced state has changed.
+    int update()
+    {
+      uint8_t now = digitalRead(pin);
+      if ((now != state) && ((millis() - previous) >= interval))
+      {
+	previous = millis();
+	state = now;
+	return 1;
+      }
+      return 0;
+    }
+
+    int read() const { return state; }
+
+  private:
+    uint8_t pin;
+    unsigned long interval;
+    unsigned long previous;
+    uint8_t state;
+};
+
+#endif
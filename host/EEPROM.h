@@ -0,0 +1,29 @@
+//-----------------------------------------------------------------------
+// EEPROM.h - The EEPROM library for the host build. The host tool
+// that uses it supplies the storage, so it can count the writes.
+
+#ifndef HOST_EEPROM_H
+#define HOST_EEPROM_H
+
+#include <stdint.h>
+#include <avr/eeprom.h>
+
+// The Mega's 4 KB.
+#define E2END 0xfff
+
+struct EEPROMClass
+{
+    uint8_t read(int address);
+    void write(int address, uint8_t value);
+    void update(int address, uint8_t value)
+    {
+	if (read(address) != value)
+	{
+	    write(address, value);
+	}
+    }
+};
+
+extern EEPROMClass EEPROM;
+
+#endif
@@ -0,0 +1,38 @@
+//-----------------------------------------------------------------------
+// RTClib.h - The parts of RTClib the clock uses, for the host build.
+// DateTime is only a holder for seconds since 1970; the host tool
+// supplies the DS3231, including what each transfer over the I2C bus
+// costs.
+
+#ifndef HOST_RTCLIB_H
+#define HOST_RTCLIB_H
+
+#include <stdint.h>
+
+class DateTime
+{
+  public:
+    DateTime(uint32_t t = 0) : t(t) {}
+    uint32_t unixtime() const { return t; }
+
+  private:
+    uint32_t t;
+};
+
+enum Ds3231SqwPinMode
+{
+    DS3231_OFF = 0x1c,
+    DS3231_SquareWave1Hz = 0x00,
+};
+
+class RTC_DS3231
+{
+  public:
+    bool begin();
+    bool lostPower();
+    static void adjust(const DateTime &dt);
+    DateTime now();
+    void writeSqwPinMode(Ds3231SqwPinMode mode);
+};
+
+#endif
@@ -0,0 +1,8 @@
+//-----------------------------------------------------------------------
+// Wire.h - The I2C library, for the host build. Nothing talks to the
+// bus directly; the RTC stand-in in RTClib.h does it all.
+
+#ifndef HOST_WIRE_H
+#define HOST_WIRE_H
+
+#endif
@@ -0,0 +1,145 @@
+//-----------------------------------------------------------------------
+// alarm-bench.cpp - Time the alarm scheduler with many alarms.
+
+// Copyright (c) 2017 Jim Thompson.
+
+//-----------------------------------------------------------------------
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+//-----------------------------------------------------------------------
+// This runs on the host, not the Arduino. Build and run it with
+//
+//     c++ -std=c++11 -O2 -Ihost -o alarm-bench host/alarm-bench.cpp
+//     ./alarm-bench
+//
+// For each number of alarms, it registers that many at random seconds
+// of the day on random days of the week, and runs a simulated week of
+// one-second ticks through AlarmScheduler, with a jump of the clock
+// every hour to exercise the binary search. It does the same with the
+// obvious alternative, checking every alarm every second, and checks
+// that both fire the same alarms. The times are host times, so only
+// the ratios mean much; what should show is that the scheduler's cost
+// per tick stays flat as the number of alarms grows.
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#define MAX_ALARMS 1000
+#include "../Alarm.h"
+
+static unsigned long scheduler_fired = 0;
+static unsigned long action_sum = 0;
+
+static void fired(uint8_t action)
+{
+    scheduler_fired++;
+    action_sum += action;
+}
+
+struct Plain
+{
+    uint32_t sod;
+    uint8_t days;
+    uint8_t action;
+};
+
+// Seconds in the simulated run, and how often the clock is jumped.
+static const uint32_t RUN = 7 * SECONDS_PER_DAY;
+static const uint32_t JUMP_EVERY = 3600;
+static const uint32_t JUMP_BY = 600;
+
+// The time of day and weekday at each tick of the run, with the jumps.
+static void clock_at(uint32_t tick, uint32_t &sod, uint8_t &weekday)
+{
+    uint32_t t = tick + (tick / JUMP_EVERY) * JUMP_BY;
+    sod = t % SECONDS_PER_DAY;
+    weekday = (t / SECONDS_PER_DAY) % 7;
+}
+
+static double nanoseconds(std::chrono::steady_clock::duration d)
+{
+    return std::chrono::duration<double, std::nano>(d).count();
+}
+
+int main()
+{
+    static const unsigned int sizes[] = { 1, 32, 100, 300, 1000 };
+
+    srand(1);
+
+    printf("alarms  scheduler ns/tick  scan-all ns/tick  fired\n");
+
+    for (unsigned int n : sizes)
+    {
+	AlarmScheduler *scheduler = new AlarmScheduler(fired);
+	std::vector<Plain> plain;
+
+	for (unsigned int i = 0; i < n; i++)
+	{
+	    Plain p;
+	    p.sod = rand() % SECONDS_PER_DAY;
+	    p.days = (rand() % ALARM_DAILY) + 1;
+	    p.action = rand() & 0xff;
+	    scheduler->add(p.sod, p.days, p.action);
+	    plain.push_back(p);
+	}
+
+	scheduler_fired = 0;
+	action_sum = 0;
+
+	std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+	for (uint32_t tick = 0; tick < RUN; tick++)
+	{
+	    uint32_t sod;
+	    uint8_t weekday;
+	    clock_at(tick, sod, weekday);
+	    scheduler->tick(sod, weekday);
+	}
+	double scheduler_ns = nanoseconds(std::chrono::steady_clock::now() - start) / RUN;
+
+	unsigned long plain_fired = 0;
+	unsigned long plain_sum = 0;
+
+	start = std::chrono::steady_clock::now();
+	for (uint32_t tick = 0; tick < RUN; tick++)
+	{
+	    uint32_t sod;
+	    uint8_t weekday;
+	    clock_at(tick, sod, weekday);
+	    for (size_t i = 0; i < plain.size(); i++)
+	    {
+		if ((plain[i].sod == sod) && (plain[i].days & (1 << weekday)))
+		{
+		    plain_fired++;
+		    plain_sum += plain[i].action;
+		}
+	    }
+	}
+	double plain_ns = nanoseconds(std::chrono::steady_clock::now() - start) / RUN;
+
+	printf("%6u %18.1f %17.1f %6lu\n", n, scheduler_ns, plain_ns, scheduler_fired);
+
+	if ((plain_fired != scheduler_fired) || (plain_sum != action_sum))
+	{
+	    printf("MISMATCH: scanning every alarm fired %lu\n", plain_fired);
+	    return 1;
+	}
+
+	delete scheduler;
+    }
+
+    return 0;
+}
@@ -0,0 +1,10 @@
+//-----------------------------------------------------------------------
+// avr/eeprom.h - EEPROM status for the host build. The host tool
+// decides when a byte has finished programming.
+
+#ifndef HOST_EEPROM_STATUS_H
+#define HOST_EEPROM_STATUS_H
+
+extern bool eeprom_is_ready();
+
+#endif
@@ -0,0 +1,15 @@
+//-----------------------------------------------------------------------
+// avr/pgmspace.h - Flash access for the host build. On the host there
+// is only one address space, so flash reads are plain reads.
+
+#ifndef HOST_PGMSPACE_H
+#define HOST_PGMSPACE_H
+
+#include <stdint.h>
+
+#define PROGMEM
+
+#define pgm_read_byte(p) (*(const uint8_t *) (p))
+#define pgm_read_word(p) (*(const uint16_t *) (p))
+
+#endif
@@ -0,0 +1,214 @@
+//-----------------------------------------------------------------------
+// dial-test.cpp - Dial synthetic digits into RotaryDial on the host.
+
+// Copyright (c) 2017 Jim Thompson.
+
+//-----------------------------------------------------------------------
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+//-----------------------------------------------------------------------
+// This runs on the host, not the Arduino. Build and run it with
+//
+//     c++ -std=c++11 -O2 -Ihost -o dial-test host/dial-test.cpp
+//     ./dial-test [-j ms]
+//
+// For dials running at 8, 10 and 12 pulses per second, it makes up
+// the contact waveform of twenty digits dialed one after another on a
+// freshly reset clock: for each pulse the contacts open for 60% of the
+// period and close for the rest, each time give or take up to -j
+// milliseconds (default 3), and bounce for a few milliseconds at every
+// change. Between digits the contacts stay closed for 600 ms, while
+// the dial is wound round for the next one. Dial.h and the debouncer
+// from Bounce.h run unchanged against it, cycled once a millisecond as
+// loop() does.
+//
+// It checks that every digit is counted right, and prints how long
+// after the contacts last closed each digit was reported, for the
+// first digit and for the rest, and the period and timeout the dial
+// ended up with. It exits with 1 if any digit was miscounted.
+
+#include <cstdio>
+#include <cstdlib>
+#include <unistd.h>
+#include <vector>
+
+#include "../Dial.h"
+
+static unsigned long now_ms = 0;
+
+unsigned long millis()
+{
+    return now_ms;
+}
+
+unsigned long micros()
+{
+    return now_ms * 1000;
+}
+
+// The contact waveform: the times at which the pin changes, and the
+// level from then on. Open contacts read high, through the pull-up.
+struct Change
+{
+    unsigned long ms;
+    uint8_t level;
+};
+
+static std::vector<Change> changes;
+static size_t next_change = 0;
+static uint8_t level = LOW;
+
+int digitalRead(uint8_t)
+{
+    while ((next_change < changes.size()) && (changes[next_change].ms <= now_ms))
+    {
+	level = changes[next_change++].level;
+    }
+    return level;
+}
+
+const uint8_t DIAL_PIN = 22;
+const unsigned long DEBOUNCE_MS = 20;
+const unsigned long WIND_MS = 600;
+const unsigned long BOUNCE_MS = 3;
+
+static const int digits[] = { 5, 1, 10, 3, 7, 2, 9, 4, 8, 6 };
+const int DIGITS = 20;
+
+// A time give or take up to the jitter.
+static unsigned long wobble(unsigned long ms, int jitter)
+{
+    return ms + (jitter ? (rand() % (2 * jitter + 1)) - jitter : 0);
+}
+
+// Change the contacts at the given time, bouncing first.
+static void contacts(unsigned long ms, uint8_t to)
+{
+    changes.push_back({ ms, to });
+    for (unsigned long t = 1; t < BOUNCE_MS; t++)
+    {
+	if (rand() % 2)
+	{
+	    changes.push_back({ ms + t, (uint8_t) !to });
+	    changes.push_back({ ms + t, to });
+	}
+    }
+}
+
+int main(int argc, char *argv[])
+{
+    int jitter = 3;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "j:")) != -1)
+    {
+	switch (opt)
+	{
+	case 'j':
+	    jitter = atoi(optarg);
+	    break;
+	default:
+	    fprintf(stderr, "usage: %s [-j ms]\n", argv[0]);
+	    return 2;
+	}
+    }
+
+    static const unsigned int rates[] = { 8, 10, 12 };
+    bool good = true;
+
+    srand(1);
+    printf("pps  right  first ms  rest mean/max ms  period  timeout\n");
+
+    for (unsigned int pps : rates)
+    {
+	unsigned long period = 1000 / pps;
+	unsigned long open = period * 6 / 10;
+
+	// Make up the waveform, noting when each digit's contacts last
+	// close.
+	changes.clear();
+	next_change = 0;
+	level = LOW;
+	now_ms = 0;
+
+	std::vector<unsigned long> closed;
+	unsigned long t = WIND_MS;
+	for (int d = 0; d < DIGITS; d++)
+	{
+	    for (int p = 0; p < digits[d % 10]; p++)
+	    {
+		contacts(t, HIGH);
+		t += wobble(open, jitter);
+		contacts(t, LOW);
+		if (p + 1 < digits[d % 10])
+		{
+		    t += wobble(period - open, jitter);
+		}
+	    }
+	    closed.push_back(t);
+	    t += WIND_MS;
+	}
+
+	RotaryDial dial(DIAL_PIN, DEBOUNCE_MS);
+
+	std::vector<int> counted;
+	std::vector<unsigned long> latency;
+	for (now_ms = 0; now_ms < t; now_ms++)
+	{
+	    int count = dial.cycle();
+	    if (count != 0)
+	    {
+		size_t d = counted.size();
+		counted.push_back(count);
+		latency.push_back(((d < closed.size()) && (now_ms >= closed[d])) ? now_ms - closed[d] : 0);
+	    }
+	}
+
+	int right = 0;
+	for (int d = 0; d < DIGITS; d++)
+	{
+	    if ((d < (int) counted.size()) && (counted[d] == digits[d % 10]))
+	    {
+		right++;
+	    }
+	}
+	if ((right != DIGITS) || (counted.size() != (size_t) DIGITS))
+	{
+	    good = false;
+	}
+
+	unsigned long rest_total = 0;
+	unsigned long rest_max = 0;
+	for (size_t d = 1; d < latency.size(); d++)
+	{
+	    rest_total += latency[d];
+	    if (latency[d] > rest_max)
+	    {
+		rest_max = latency[d];
+	    }
+	}
+
+	printf("%3u  %2d/%-2d  %8lu  %9.1f/%-6lu  %6ld  %7ld\n", pps, right, DIGITS,
+	       latency.empty() ? 0 : latency[0],
+	       (latency.size() > 1) ? (double) rest_total / (latency.size() - 1) : 0.0,
+	       rest_max, dial.pulse_period(), dial.dwell_timeout());
+    }
+
+    if (!good)
+    {
+	printf("MISCOUNTED\n");
+	return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,220 @@
+//-----------------------------------------------------------------------
+// epoch-bench.cpp - Time the epoch conversions against RTClib's.
+
+// Copyright (c) 2017 Jim Thompson.
+
+//-----------------------------------------------------------------------
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+//-----------------------------------------------------------------------
+// This runs on the host, not the Arduino. Build and run it with
+//
+//     c++ -std=c++11 -O2 -Ihost -o epoch-bench host/epoch-bench.cpp
+//     ./epoch-bench
+//
+// It runs a year of one-second ticks, starting in 2017, four ways:
+//
+//   rtclib   What the clock used to do every second: make a DateTime
+//            from the time, take its hour, minute and second, and
+//            turn it back into seconds since 1970 with unixtime().
+//            The DateTime code is a copy of RTClib's, below.
+//   set      epoch_set() every second: the full conversion.
+//   update   epoch_update() every second, as loop() does.
+//   tick     epoch_tick() every second, as a PPS pulse does.
+//
+// and checks that all four come up with the same time of day and date
+// every second. The times are host times, so only the ratios mean
+// much; on the AVR, where 32-bit division is done in software, the
+// gap between the conversions and the tick is wider still. epoch_set()
+// steps through the years from 1970 where RTClib starts at 2000, so it
+// comes out slower than RTClib's conversion, but it's only needed when
+// the time jumps.
+
+#include <chrono>
+#include <cstdio>
+
+#include "../epoch.cpp"
+
+//-----------------------------------------------------------------------
+// RTClib's DateTime, cut down to the conversions to and from seconds
+// since 1970 and copied here so that it builds on the host. Years are
+// counted from 2000, and the range is 2000 to 2099.
+
+const uint32_t SECONDS_FROM_1970_TO_2000 = 946684800UL;
+
+static const uint8_t daysInMonth[] PROGMEM = {
+    31, 28, 31, 30, 31, 30, 31, 31, 30, 31, 30,
+};
+
+static uint16_t date2days(uint16_t y, uint8_t m, uint8_t d)
+{
+    if (y >= 2000U)
+    {
+	y -= 2000U;
+    }
+    uint16_t days = d;
+    for (uint8_t i = 1; i < m; ++i)
+    {
+	days += pgm_read_byte(daysInMonth + i - 1);
+    }
+    if (m > 2 && y % 4 == 0)
+    {
+	++days;
+    }
+    return days + 365 * y + (y + 3) / 4 - 1;
+}
+
+static uint32_t time2ulong(uint16_t days, uint8_t h, uint8_t m, uint8_t s)
+{
+    return ((days * 24UL + h) * 60 + m) * 60 + s;
+}
+
+class DateTime
+{
+  public:
+    DateTime(uint32_t t)
+    {
+	t -= SECONDS_FROM_1970_TO_2000;
+
+	ss = t % 60;
+	t /= 60;
+	mm = t % 60;
+	t /= 60;
+	hh = t % 24;
+	uint16_t days = t / 24;
+	uint8_t leap;
+	for (yOff = 0;; ++yOff)
+	{
+	    leap = yOff % 4 == 0;
+	    if (days < 365U + leap)
+	    {
+		break;
+	    }
+	    days -= 365 + leap;
+	}
+	for (m = 1; m < 12; ++m)
+	{
+	    uint8_t daysPerMonth = pgm_read_byte(daysInMonth + m - 1);
+	    if (leap && m == 2)
+	    {
+		++daysPerMonth;
+	    }
+	    if (days < daysPerMonth)
+	    {
+		break;
+	    }
+	    days -= daysPerMonth;
+	}
+	d = days + 1;
+    }
+
+    uint16_t year() const { return 2000U + yOff; }
+    uint8_t month() const { return m; }
+    uint8_t day() const { return d; }
+    uint8_t hour() const { return hh; }
+    uint8_t minute() const { return mm; }
+    uint8_t second() const { return ss; }
+
+    uint32_t unixtime() const
+    {
+	return time2ulong(date2days(yOff, m, d), hh, mm, ss) + SECONDS_FROM_1970_TO_2000;
+    }
+
+  private:
+    uint8_t yOff, m, d, hh, mm, ss;
+};
+
+//-----------------------------------------------------------------------
+
+static const uint32_t START = 1483228800UL; // 2017-01-01 00:00:00
+static const uint32_t RUN = 366 * EPOCH_SECONDS_PER_DAY;
+
+// What each way shows each second, packed into one number to compare.
+static uint32_t shown[RUN];
+
+static uint32_t pack(uint16_t year, uint8_t month, uint8_t day, uint8_t hour, uint8_t minute,
+		     uint8_t second)
+{
+    return ((((((uint32_t) (year - 2000) * 13 + month) * 32 + day) * 24 + hour) * 60 + minute) *
+	    60) + second;
+}
+
+static double nanoseconds(std::chrono::steady_clock::duration d)
+{
+    return std::chrono::duration<double, std::nano>(d).count();
+}
+
+// Run one way, filling in or checking shown[]. Returns the time per
+// tick in nanoseconds, or a negative number on a mismatch.
+template<typename Way> static double run(Way way, bool fill)
+{
+    std::chrono::steady_clock::time_point start = std::chrono::steady_clock::now();
+    uint32_t mismatches = 0;
+    for (uint32_t i = 0; i < RUN; i++)
+    {
+	uint32_t packed = way(START + i);
+	if (fill)
+	{
+	    shown[i] = packed;
+	}
+	else if (shown[i] != packed)
+	{
+	    mismatches++;
+	}
+    }
+    double ns = nanoseconds(std::chrono::steady_clock::now() - start) / RUN;
+    return mismatches ? -1 : ns;
+}
+
+int main()
+{
+    epoch_time e;
+
+    double rtclib_ns = run([](uint32_t t) {
+	    DateTime now(t);
+	    uint32_t packed = pack(now.year(), now.month(), now.day(), now.hour(), now.minute(),
+				   now.second());
+	    return (now.unixtime() == t) ? packed : 0;
+	}, true);
+
+    double set_ns = run([&e](uint32_t t) {
+	    epoch_set(e, t);
+	    return pack(e.year, e.month, e.day, e.hour, e.minute, e.second);
+	}, false);
+
+    epoch_set(e, START - 1);
+    double update_ns = run([&e](uint32_t t) {
+	    epoch_update(e, t);
+	    return pack(e.year, e.month, e.day, e.hour, e.minute, e.second);
+	}, false);
+
+    epoch_set(e, START - 1);
+    double tick_ns = run([&e](uint32_t) {
+	    epoch_tick(e);
+	    return pack(e.year, e.month, e.day, e.hour, e.minute, e.second);
+	}, false);
+
+    printf("way      ns/tick\n");
+    printf("rtclib  %8.2f\n", rtclib_ns);
+    printf("set     %8.2f\n", set_ns);
+    printf("update  %8.2f\n", update_ns);
+    printf("tick    %8.2f\n", tick_ns);
+
+    if ((set_ns < 0) || (update_ns < 0) || (tick_ns < 0))
+    {
+	printf("MISMATCH\n");
+	return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,145 @@
+//-----------------------------------------------------------------------
+// epoch-test.cpp - Check the epoch time conversions on the host.
+
+// Copyright (c) 2017 Jim Thompson.
+
+//-----------------------------------------------------------------------
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+//-----------------------------------------------------------------------
+// This runs on the host, not the Arduino. Build and run it with
+//
+//     c++ -std=c++11 -O2 -Ihost -o epoch-test host/epoch-test.cpp
+//     ./epoch-test
+//
+// It builds epoch.cpp unchanged and checks it against the host's
+// gmtime() over the whole range of 32-bit times, 1970 to 2106:
+//
+//   set      epoch_set() at every 997th second (a prime, so every
+//            second of the day and minute gets tried).
+//   dates    epoch_from_date() of every date, and epoch_set() of the
+//            time it gives back, round trip.
+//   months   epoch_days_in_month() of every month.
+//   ticks    epoch_update() one second at a time through every second
+//            of the range, checked at every midnight, and at every
+//            100,003rd second in between.
+//
+// It prints the number of checks and failures for each, and exits with
+// 1 if anything failed. It takes half a minute or so.
+
+#include <cstdio>
+#include <ctime>
+
+#include "../epoch.cpp"
+
+static const uint64_t LAST = 0xffffffffULL;
+
+// Does an epoch_time agree with gmtime() for t?
+static bool agrees(const epoch_time &e, uint32_t t)
+{
+    time_t tt = t;
+    struct tm g;
+    gmtime_r(&tt, &g);
+
+    return (e.t == t) && (e.year == g.tm_year + 1900) && (e.month == g.tm_mon + 1) &&
+	(e.day == g.tm_mday) && (e.hour == g.tm_hour) && (e.minute == g.tm_min) &&
+	(e.second == g.tm_sec) && (e.weekday == g.tm_wday) &&
+	(e.sod == (uint32_t) (g.tm_hour * 3600 + g.tm_min * 60 + g.tm_sec));
+}
+
+// Failures so far; only the first few are printed.
+static unsigned long failures = 0;
+
+static void report(const char *name, unsigned long checks, unsigned long failed)
+{
+    printf("%-8s %11lu checks %6lu failed%s\n", name, checks, failed, failed ? "  WRONG" : "");
+}
+
+static void fail(const char *name, uint64_t t)
+{
+    if (failures++ < 10)
+    {
+	printf("%s: wrong at %llu\n", name, (unsigned long long) t);
+    }
+}
+
+int main()
+{
+    epoch_time e;
+    unsigned long checks;
+    unsigned long before;
+
+    checks = 0;
+    before = failures;
+    for (uint64_t t = 0; t <= LAST; t += 997)
+    {
+	epoch_set(e, t);
+	checks++;
+	if (!agrees(e, t))
+	{
+	    fail("set", t);
+	}
+    }
+    report("set", checks, failures - before);
+
+    checks = 0;
+    before = failures;
+    for (uint64_t t = 0; t <= LAST; t += EPOCH_SECONDS_PER_DAY)
+    {
+	epoch_set(e, t);
+	checks++;
+	if (!agrees(e, t) || (epoch_from_date(e.year, e.month, e.day) != t))
+	{
+	    fail("dates", t);
+	}
+    }
+    report("dates", checks, failures - before);
+
+    // The first day of each month, and the last.
+    checks = 0;
+    before = failures;
+    for (uint16_t year = 1970; year < 2106; year++)
+    {
+	for (uint8_t month = 1; month <= 12; month++)
+	{
+	    uint8_t days = epoch_days_in_month(year, month);
+	    epoch_set(e, epoch_from_date(year, month, 1) + (days - 1) * EPOCH_SECONDS_PER_DAY);
+	    checks++;
+	    if ((e.month != month) || (e.day != days))
+	    {
+		fail("months (year * 100 + month)", year * 100 + month);
+	    }
+	}
+    }
+    report("months", checks, failures - before);
+
+    checks = 0;
+    before = failures;
+    epoch_set(e, 0);
+    for (uint64_t t = 1; t <= LAST; t++)
+    {
+	epoch_update(e, t);
+	if ((e.sod == 0) || ((t % 100003) == 0))
+	{
+	    checks++;
+	    if (!agrees(e, t))
+	    {
+		fail("ticks", t);
+	    }
+	}
+    }
+    report("ticks", checks, failures - before);
+
+    return failures ? 1 : 0;
+}
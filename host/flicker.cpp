@@ -0,0 +1,1026 @@
+//-----------------------------------------------------------------------
+// flicker.cpp - Run the clock on the host and measure what the tubes
+// would look like.
+
+// Copyright (c) 2017 Jim Thompson.
+
+//-----------------------------------------------------------------------
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+//-----------------------------------------------------------------------
+// This runs on the host, not the Arduino. Build it with
+//
+//     c++ -std=c++11 -O2 -Ihost -o flicker host/flicker.cpp
+//
+// adding -DBOARD_TAG_uno to simulate the Uno's pin mapping, or
+// -DNIXIE_BANKS=2 to simulate a second tube bank. It compiles the
+// clock - master-clock.cpp, nixie.cpp, nixie-parallel.cpp and the rest
+// - against the stand-in Arduino, Wire, RTClib, Bounce and EEPROM
+// headers in this directory, and runs its own setup() and then loop()
+// on a simulated clock. So the order of things in loop(), PERIOD, and
+// the time taken by the journal, the console, the dial and the RTC all
+// come from the firmware itself.
+//
+// The simulated clock only moves when the firmware calls out: each
+// port write in the multiplexer, each call into the Arduino core
+// (micros(), digitalWrite() and so on), each byte through the serial
+// port and each transfer with the RTC is charged a rough number of
+// cycles, set out below. The firmware's own arithmetic between those
+// calls isn't counted, except for a fixed allowance per call of
+// nixie_multiplex() and the work the display drivers report through
+// NIXIE_WORK() (see nixie.cpp). The RTC is there from the start (unless -n), with
+// its time at 12:34:55 so that the hour and minute tubes change during
+// the run, and its PPS square wave interrupts the firmware at isr()
+// whenever interrupts are enabled, just as on the Arduino.
+//
+// Every write to a port is timestamped, and from those we work out,
+// for each tube:
+//
+//   duty        The fraction of the time the tube is lit.
+//   refresh     How often the tube is lit, and the shortest and
+//               longest intervals between one lighting and the next.
+//   dark gap    The longest time the tube goes unlit.
+//   spectrum    The brightness modulation at each frequency from 1 Hz
+//               up, relative to the average brightness. Anything much
+//               below 100 Hz is visible as flicker.
+//   ghosting    Time spent lit while the cathodes showed something
+//               other than the digit the tube ends up showing.
+//
+// and, for each bank, the blanking margin: how long after the last
+// anode goes off the cathodes change. A nixie needs some tens of
+// microseconds to stop glowing, so a short margin shows up as a faint
+// ghost of the previous digit. It also reports the time spent in each
+// call of nixie_multiplex(), with each port write costed by where the
+// port is, which is what the second bank costs; the longest gap between
+// calls, which is where anything else in loop() stalls the display; the
+// number of port writes per call; the cost per slot split between slots
+// that play a transition frame and those that don't, which is what
+// transitions cost (compare -x 0 with -x 1 and -x 2, bearing in mind
+// that the frame lookup is an assumed cost); the time spent in
+// nixie_parallel_cycle() and nixie_writeall(); how long after reset
+// setup() first lit the tubes, which is mostly the journal reading back
+// the EEPROM; and how long after each PPS edge the new time reached the
+// tubes, and whether it was the RTC's time - run with and without -e to
+// see whether the cathode exercise disturbs the timekeeping. Time spent
+// in isr() is left out of the figures for the calls it interrupted.
+// Last come the memory figures the clock's console reports for the
+// multiplexer: the RAM taken by its variables and tables, and the
+// deepest the stack got inside a call. Both are host sizes - pointers
+// and ints are wider here, and the stack depth is measured at each port
+// write, in host stack frames - so they're only good for comparing one
+// change with another. The rest of the 'M' report - free RAM, the
+// stack's high-water mark, the depth in isr() and the table of each
+// part's RAM - comes from the AVR's stack paint and linker symbols, and
+// isn't available on the host.
+//
+// Options (all optional):
+//
+//   -t seconds    Length of the run (default 10)
+//   -b us         Blanking margin to warn below (default 100)
+//   -x style      Digit transition style (default none set, see
+//                 nixie.cpp)
+//   -f frames     Frames out of 8 the extra banks are lit (default
+//                 none set)
+//   -e passes     Start a cathode exercise run of this many passes on
+//                 every tube once setup() is done (default 0, none)
+//   -c command    A console command, waiting on the serial port a
+//                 second before the end of the run, so its reply
+//                 covers the whole run. May be given more than once.
+//   -n            Run without the RTC, free running
+//   -o prefix     Prefix for the output files (default "flicker")
+//
+// The style and frames are set as the console's 'C' command would,
+// once setup() is done, and taken up by loop() on the next second.
+//
+// Three CSV files are written: prefix-transitions.csv, every change in
+// each bank's anode and cathode outputs; prefix-tubes.csv, the per-tube
+// figures; and prefix-spectrum.csv, the modulation spectrum. Everything
+// the clock sends to the serial port goes to prefix-serial.txt. A
+// summary goes to standard output.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <complex>
+#include <vector>
+
+// The simulated clock, in CPU cycles at 16 MHz.
+static unsigned long long cycles = 0;
+static const unsigned long long CPU_HZ = 16000000ULL;
+
+// Move the clock on, taking the PPS interrupt if it's due.
+static void charge(unsigned long long n);
+
+// Rough costs, in cycles, of the things the simulation does. These
+// only need to be about right; they set the time between the port
+// writes within one call of the multiplexer. A write to one pin of a
+// port in the bottom of the I/O space (PORTA to PORTG) is a single sbi
+// or cbi. Further up the I/O space it's in, ori or andi, and out; and
+// above the I/O space (PORTH to PORTL on the Mega) it's lds, ori or
+// andi, and sts. MULTIPLEX_CYCLES is everything else in a call.
+static const unsigned int BIT_WRITE_CYCLES = 2;
+static const unsigned int IO_WRITE_CYCLES = 3;
+static const unsigned int MEMORY_WRITE_CYCLES = 5;
+static const unsigned int MULTIPLEX_CYCLES = 80;
+
+static unsigned int port_write_cycles(uint16_t port)
+{
+    if (port < 0x40)
+    {
+	return BIT_WRITE_CYCLES;
+    }
+    return (port < 0x60) ? IO_WRITE_CYCLES : MEMORY_WRITE_CYCLES;
+}
+
+// Playing a transition frame in lightTube(): reading the frame from
+// flash, moving the transition on, and looking up the wheel. This one
+// is assumed, not counted from the compiled code, so the difference
+// it makes to a transition frame slot is only as good as the guess;
+// count the instructions in lightTube() from avr-objdump -d to check
+// it.
+static const unsigned int TRANSITION_FRAME_CYCLES = 20;
+
+// The work the display drivers report through NIXIE_WORK(): adding a
+// slot to a cathode's 32 bit on-time, moving the exercise run on a
+// frame, and the same two for the parallel tubes, per tube and per
+// call of nixie_parallel_cycle().
+static const unsigned int CATHODE_COUNT_CYCLES = 24;
+static const unsigned int EXERCISE_FRAME_CYCLES = 20;
+static const unsigned int PARALLEL_COUNT_CYCLES = 30;
+static const unsigned int PARALLEL_EXERCISE_STEP_CYCLES = 30;
+
+// The Arduino core, per call. digitalWrite() and digitalRead() look
+// the pin up in flash and turn off any PWM on it first, which is why
+// they're so much dearer than a port write.
+static const unsigned int MICROS_CYCLES = 40;
+static const unsigned int MILLIS_CYCLES = 30;
+static const unsigned int DIGITAL_WRITE_CYCLES = 70;
+static const unsigned int DIGITAL_READ_CYCLES = 60;
+static const unsigned int SERIAL_CALL_CYCLES = 20;
+
+// Getting into and out of isr(), through the core's dispatch.
+static const unsigned int ISR_CYCLES = 80;
+
+// The serial port: a 63 byte transmit buffer, emptied at 115200 baud.
+// A write to a full buffer waits for a byte to go.
+static const unsigned int SERIAL_BUFFER = 63;
+static const unsigned long long SERIAL_BYTE_CYCLES = CPU_HZ * 10 / 115200;
+
+// The EEPROM: reading or starting to write a byte, and how long a
+// write keeps it busy.
+static const unsigned int EEPROM_READ_CYCLES = 30;
+static const unsigned int EEPROM_WRITE_CYCLES = 40;
+static const unsigned long long EEPROM_BUSY_CYCLES = CPU_HZ * 33 / 10000;
+
+// One byte over I2C at 100 kHz, with its acknowledge. Wire waits for
+// each transfer to finish, with interrupts on.
+static const unsigned long long I2C_BYTE_CYCLES = CPU_HZ * 9 / 100000;
+
+static void port_written(uint16_t port);
+
+#if !defined(BOARD_TAG_uno) && !defined(BOARD_TAG_mega)
+#define BOARD_TAG_mega
+#endif
+
+// The clock itself. nixie.cpp has a variable called index, which the C
+// library has too, and nixie-parallel.cpp has a tubes of its own. The
+// calls from loop() to the display drivers are pointed at wrappers
+// below, which time them.
+#define NIXIE_PORT_WRITTEN(port) port_written(port)
+#define NIXIE_WORK(work) charge(work##_CYCLES)
+#define index multiplex_index
+#include "../nixie.cpp"
+#undef index
+
+#define tubes parallel_tubes
+#define shown parallel_shown
+#include "../nixie-parallel.cpp"
+#undef tubes
+#undef shown
+
+#include "../epoch.cpp"
+#include "../journal.cpp"
+#include "../console.cpp"
+
+#define nixie_multiplex host_nixie_multiplex
+#define nixie_parallel_cycle host_nixie_parallel_cycle
+#define nixie_writeall host_nixie_writeall
+#include "../master-clock.cpp"
+#undef nixie_multiplex
+#undef nixie_parallel_cycle
+#undef nixie_writeall
+
+volatile uint8_t host_memory[0x200];
+
+// The interrupt: whether it's enabled and attached, whether we're in
+// it, and how long has been spent in it altogether.
+static bool interrupts_on = true;
+static void (*attached_isr)() = 0;
+static bool in_isr = false;
+static unsigned long long isr_cycles = 0;
+
+// The RTC. Its time is rtc_base until its first rollover, at
+// RTC_ROLLOVER, and counts on once a second from there. Once its
+// square wave is on, it rises half a second after each rollover.
+static bool rtc_present = true;
+static uint32_t rtc_base = 0;
+static const unsigned long long RTC_ROLLOVER = CPU_HZ / 10;
+static bool rtc_square_wave = false;
+static unsigned long long next_edge = 0;
+
+// The last PPS edge taken, and whether the time hasn't yet been
+// written out to the tubes since.
+static unsigned long long edge_at = 0;
+static bool edge_pending = false;
+static unsigned long edges = 0;
+
+static uint32_t rtc_seconds(unsigned long long at)
+{
+    return rtc_base + (at + CPU_HZ - RTC_ROLLOVER) / CPU_HZ;
+}
+
+static void charge(unsigned long long n)
+{
+    cycles += n;
+
+    if (!rtc_square_wave || !attached_isr || !interrupts_on || in_isr ||
+	(cycles < next_edge))
+    {
+	return;
+    }
+
+    // Only one edge is latched, however many have gone by.
+    edge_at = next_edge;
+    while (next_edge <= cycles)
+    {
+	next_edge += CPU_HZ;
+    }
+    edge_pending = true;
+    edges++;
+
+    unsigned long long before = cycles;
+    in_isr = true;
+    cycles += ISR_CYCLES;
+    attached_isr();
+    in_isr = false;
+    isr_cycles += cycles - before;
+}
+
+unsigned long micros()
+{
+    charge(MICROS_CYCLES);
+    return cycles / (CPU_HZ / 1000000);
+}
+
+unsigned long millis()
+{
+    charge(MILLIS_CYCLES);
+    return cycles / (CPU_HZ / 1000);
+}
+
+void digitalWrite(uint8_t, uint8_t)
+{
+    charge(DIGITAL_WRITE_CYCLES);
+}
+
+// Nothing is pressed, dialed or switched: every input reads high, as
+// its pull-up leaves it.
+int digitalRead(uint8_t)
+{
+    charge(DIGITAL_READ_CYCLES);
+    return HIGH;
+}
+
+void attachInterrupt(uint8_t, void (*isr)(), int)
+{
+    attached_isr = isr;
+}
+
+void noInterrupts()
+{
+    interrupts_on = false;
+}
+
+void interrupts()
+{
+    interrupts_on = true;
+    charge(1);
+}
+
+// The serial port. What the clock prints goes to a file, and the
+// console commands from -c arrive at serial_input_at.
+HardwareSerial Serial;
+static FILE *serial_log;
+static std::vector<uint8_t> serial_input;
+static size_t serial_read = 0;
+static unsigned long long serial_input_at = 0;
+static unsigned int serial_queued = 0;
+static unsigned long long serial_next = 0;
+
+// Take out the bytes that have gone by now.
+static void serial_drain()
+{
+    while (serial_queued && (cycles >= serial_next))
+    {
+	serial_queued--;
+	serial_next += SERIAL_BYTE_CYCLES;
+    }
+}
+
+int HardwareSerial::available()
+{
+    charge(SERIAL_CALL_CYCLES);
+    return (cycles >= serial_input_at) ? serial_input.size() - serial_read : 0;
+}
+
+int HardwareSerial::read()
+{
+    charge(SERIAL_CALL_CYCLES);
+    return (serial_read < serial_input.size()) ? serial_input[serial_read++] : -1;
+}
+
+int HardwareSerial::availableForWrite()
+{
+    charge(SERIAL_CALL_CYCLES);
+    serial_drain();
+    return SERIAL_BUFFER - serial_queued;
+}
+
+size_t HardwareSerial::write(uint8_t c)
+{
+    charge(SERIAL_CALL_CYCLES);
+    serial_drain();
+    if (serial_queued == SERIAL_BUFFER)
+    {
+	charge(serial_next - cycles);
+	serial_drain();
+    }
+    if (serial_queued++ == 0)
+    {
+	serial_next = cycles + SERIAL_BYTE_CYCLES;
+    }
+
+    if (c != '\r')
+    {
+	fputc(c, serial_log);
+    }
+    return 1;
+}
+
+// The EEPROM, blank to start with.
+EEPROMClass EEPROM;
+static uint8_t eeprom_cells[E2END + 1];
+static unsigned long long eeprom_ready = 0;
+
+bool eeprom_is_ready()
+{
+    return cycles >= eeprom_ready;
+}
+
+uint8_t EEPROMClass::read(int address)
+{
+    if (!eeprom_is_ready())
+    {
+	charge(eeprom_ready - cycles);
+    }
+    charge(EEPROM_READ_CYCLES);
+    return eeprom_cells[address];
+}
+
+void EEPROMClass::write(int address, uint8_t value)
+{
+    if (!eeprom_is_ready())
+    {
+	charge(eeprom_ready - cycles);
+    }
+    charge(EEPROM_WRITE_CYCLES);
+    eeprom_cells[address] = value;
+    eeprom_ready = cycles + EEPROM_BUSY_CYCLES;
+}
+
+// The DS3231 on the I2C bus, each call charged by the bytes it moves,
+// addresses included. An absent RTC fails to acknowledge its address.
+bool RTC_DS3231::begin()
+{
+    charge(I2C_BYTE_CYCLES);
+    return rtc_present;
+}
+
+bool RTC_DS3231::lostPower()
+{
+    charge(4 * I2C_BYTE_CYCLES);
+    return false;
+}
+
+void RTC_DS3231::adjust(const DateTime &dt)
+{
+    charge(16 * I2C_BYTE_CYCLES);
+    rtc_base = dt.unixtime() - rtc_seconds(cycles) + rtc_base;
+}
+
+DateTime RTC_DS3231::now()
+{
+    charge(10 * I2C_BYTE_CYCLES);
+    return DateTime(rtc_seconds(cycles));
+}
+
+void RTC_DS3231::writeSqwPinMode(Ds3231SqwPinMode mode)
+{
+    charge(7 * I2C_BYTE_CYCLES);
+    rtc_square_wave = (mode == DS3231_SquareWave1Hz);
+
+    // The first edge to come.
+    next_edge = RTC_ROLLOVER + CPU_HZ / 2;
+    while (next_edge <= cycles)
+    {
+	next_edge += CPU_HZ;
+    }
+}
+
+// memory.cpp reads the AVR's stack paint and linker symbols, so it
+// isn't built here; see the top of the file.
+uint16_t memory_static()
+{
+    return 0;
+}
+
+uint16_t memory_free()
+{
+    return 0;
+}
+
+uint16_t memory_min_free()
+{
+    return 0;
+}
+
+bool memory_report(uint16_t piece)
+{
+    if (piece > 0)
+    {
+	return false;
+    }
+    Serial.println("Memory is only measured on the Arduino.");
+    return true;
+}
+
+static const int BANKS = NIXIE_BANKS;
+static const int TUBES = 6 * BANKS;
+
+// The first anode and cathode pin of each bank; see nixie.cpp.
+static const int first_anode_pin[] = { 2, BANK1_ANODES };
+static const int first_cathode_pin[] = { 8, BANK1_CATHODES };
+
+// Everything we track for one tube.
+struct Tube
+{
+    bool lit;
+    unsigned long long lit_at;	// When it was last lit
+    unsigned long long dark_at;	// When it last went dark
+    unsigned long long lit_total;
+    unsigned long long max_dark;
+    unsigned long long min_interval;
+    unsigned long long max_interval;
+    unsigned long lightings;
+
+    // The cathode codes shown while lit this time, and when each
+    // started, for working out the ghosting at the end.
+    std::vector<std::pair<unsigned long long, int> > segments;
+    unsigned long long ghost_total;
+
+    std::vector<std::complex<double> > spectrum;
+};
+
+static Tube tubes[TUBES];
+
+static int last_anodes[BANKS];
+static int last_cathodes[BANKS];
+static unsigned long long last_dark[BANKS];	// When the last anode went off
+
+static unsigned long long min_margin[BANKS];
+static unsigned long margin_warnings[BANKS];
+static unsigned long long margin_limit = 0;
+
+static FILE *transition_log;
+static unsigned int max_frequency = 1000;
+
+static bool pin(int p)
+{
+    return (BOARD_PORT(board_pin_port(p)) & board_pin_mask(p)) != 0;
+}
+
+// Add one lit interval of a tube into its spectrum.
+static void add_pulse(Tube &t, unsigned long long from, unsigned long long to)
+{
+    double t0 = (double) from / CPU_HZ;
+    double t1 = (double) to / CPU_HZ;
+
+    for (unsigned int f = 1; f <= max_frequency; f++)
+    {
+	double w = 2 * M_PI * f;
+	t.spectrum[f] += (std::polar(1.0, -w * t0) - std::polar(1.0, -w * t1)) /
+	    std::complex<double>(0, w);
+    }
+}
+
+static void bank_written(int b)
+{
+    int anodes = 0;
+    for (int i = 0; i < 6; i++)
+    {
+	if (pin(first_anode_pin[b] + i))
+	{
+	    anodes |= 1 << i;
+	}
+    }
+
+    int cathodes = 0;
+    for (int i = 0; i < 4; i++)
+    {
+	if (pin(first_cathode_pin[b] + i))
+	{
+	    cathodes |= 1 << i;
+	}
+    }
+
+    if ((anodes == last_anodes[b]) && (cathodes == last_cathodes[b]))
+    {
+	return;
+    }
+
+    fprintf(transition_log, "%.3f,%d,%02x,%d\n", cycles / 16.0, b, anodes, cathodes);
+
+    // A change of cathodes with every tube dark: how long since the
+    // last one went dark?
+    if ((cathodes != last_cathodes[b]) && (last_cathodes[b] >= 0) && (anodes == 0))
+    {
+	unsigned long long margin = cycles - last_dark[b];
+	if (margin < min_margin[b])
+	{
+	    min_margin[b] = margin;
+	}
+	if (margin < margin_limit)
+	{
+	    margin_warnings[b]++;
+	}
+    }
+
+    for (int i = 0; i < 6; i++)
+    {
+	Tube &t = tubes[b * 6 + i];
+	bool on = anodes & (1 << i);
+
+	if (on && !t.lit)
+	{
+	    if (t.lightings > 0)
+	    {
+		unsigned long long interval = cycles - t.lit_at;
+		unsigned long long dark = cycles - t.dark_at;
+
+		if (interval < t.min_interval) t.min_interval = interval;
+		if (interval > t.max_interval) t.max_interval = interval;
+		if (dark > t.max_dark) t.max_dark = dark;
+	    }
+
+	    t.lit = true;
+	    t.lit_at = cycles;
+	    t.lightings++;
+	    t.segments.clear();
+	    t.segments.push_back(std::make_pair(cycles, cathodes));
+	}
+	else if (!on && t.lit)
+	{
+	    t.lit = false;
+	    t.dark_at = cycles;
+	    t.lit_total += cycles - t.lit_at;
+	    last_dark[b] = cycles;
+
+	    // Everything shown before the final cathodes was a ghost.
+	    int shown = t.segments.back().second;
+	    for (size_t s = 0; s < t.segments.size(); s++)
+	    {
+		if (t.segments[s].second != shown)
+		{
+		    unsigned long long end = (s + 1 < t.segments.size()) ?
+			t.segments[s + 1].first : cycles;
+		    t.ghost_total += end - t.segments[s].first;
+		}
+	    }
+
+	    add_pulse(t, t.lit_at, cycles);
+	}
+	else if (on && (cathodes != last_cathodes[b]))
+	{
+	    t.segments.push_back(std::make_pair(cycles, cathodes));
+	}
+    }
+
+    last_anodes[b] = anodes;
+    last_cathodes[b] = cathodes;
+}
+
+// Port writes so far, and how many of them were above the I/O space.
+static unsigned long long port_writes = 0;
+static unsigned long long memory_writes = 0;
+
+// The stack pointer, near enough, on the way into nixie_multiplex(),
+// and the deepest the stack has been below it at a port write.
+static char *multiplex_stack = 0;
+static unsigned long multiplex_stack_max = 0;
+
+static void port_written(uint16_t port)
+{
+    char here;
+    if (multiplex_stack && ((unsigned long) (multiplex_stack - &here) > multiplex_stack_max))
+    {
+	multiplex_stack_max = multiplex_stack - &here;
+    }
+
+    charge(port_write_cycles(port));
+    port_writes++;
+    if (port >= 0x60)
+    {
+	memory_writes++;
+    }
+
+    for (int b = 0; b < BANKS; b++)
+    {
+	bank_written(b);
+    }
+}
+
+// The time taken by calls of one function, less any time in isr().
+struct Timing
+{
+    unsigned long long total;
+    unsigned long long max;
+    unsigned long calls;
+
+    unsigned long long started;
+    unsigned long long isr_before;
+
+    void start()
+    {
+	started = cycles;
+	isr_before = isr_cycles;
+    }
+
+    void stop()
+    {
+	unsigned long long spent = cycles - started - (isr_cycles - isr_before);
+	total += spent;
+	calls++;
+	if (spent > max)
+	{
+	    max = spent;
+	}
+    }
+
+    void print(const char *name) const
+    {
+	printf("%s: %.2f us mean, %.2f us max per call, %lu calls\n", name,
+	       calls ? (double) total / calls / 16.0 : 0.0, max / 16.0, calls);
+    }
+};
+
+static Timing multiplex_timing;
+static Timing parallel_timing;
+static Timing writeall_timing;
+
+// The same as multiplex_timing, split between slots that play a
+// transition frame and slots that don't.
+static Timing slot_timing[2];
+
+// The longest time between the starts of one call of nixie_multiplex()
+// and the next.
+static unsigned long long multiplex_last = 0;
+static unsigned long long multiplex_gap_max = 0;
+
+// When the exercise run ended, to show that it doesn't disturb the
+// timekeeping.
+static unsigned long long exercise_end = 0;
+
+// How long after each PPS edge the new time was written out to the
+// tubes, and how many times it wasn't the RTC's.
+static unsigned long long display_late_total = 0;
+static unsigned long long display_late_max = 0;
+static unsigned long display_updates = 0;
+static unsigned long display_wrong = 0;
+
+void host_nixie_multiplex()
+{
+    if (multiplex_last && (cycles - multiplex_last > multiplex_gap_max))
+    {
+	multiplex_gap_max = cycles - multiplex_last;
+    }
+    multiplex_last = cycles;
+
+    // Will this slot's tube play a transition frame?
+    unsigned int tube = multiplex_index - 1;
+    bool frame = (tube < 4) && transitions[tube].left &&
+	(bank_pattern[0] & frame_bit) && !(exercise_tubes & (1 << tube));
+
+    multiplex_timing.start();
+    slot_timing[frame].start();
+    charge(MULTIPLEX_CYCLES);
+    if (frame)
+    {
+	charge(TRANSITION_FRAME_CYCLES);
+    }
+    char stack;
+    multiplex_stack = &stack;
+    nixie_multiplex();
+    multiplex_stack = 0;
+    multiplex_timing.stop();
+    slot_timing[frame].stop();
+
+    if ((exercise_end == 0) && !nixie_exercising())
+    {
+	exercise_end = cycles;
+    }
+}
+
+void host_nixie_parallel_cycle()
+{
+    parallel_timing.start();
+    nixie_parallel_cycle();
+    parallel_timing.stop();
+}
+
+void host_nixie_writeall()
+{
+    writeall_timing.start();
+    nixie_writeall();
+    writeall_timing.stop();
+
+    if (!edge_pending)
+    {
+	return;
+    }
+    edge_pending = false;
+
+    unsigned long long late = cycles - edge_at;
+    display_late_total += late;
+    display_updates++;
+    if (late > display_late_max)
+    {
+	display_late_max = late;
+    }
+
+    if (soft_time != rtc_seconds(edge_at))
+    {
+	display_wrong++;
+    }
+}
+
+int main(int argc, char **argv)
+{
+    double seconds = 10;
+    unsigned long margin_us = 100;
+    int style = -1;
+    int frames = -1;
+    int passes = 0;
+    const char *prefix = "flicker";
+
+    for (int i = 1; i < argc; i++)
+    {
+	if (argv[i][1] == 'n')
+	{
+	    rtc_present = false;
+	    continue;
+	}
+
+	if (i + 1 == argc)
+	{
+	    fprintf(stderr, "%s needs a value\n", argv[i]);
+	    return 2;
+	}
+	const char *value = argv[++i];
+
+	switch(argv[i - 1][1])
+	{
+	case 't': seconds = atof(value); break;
+	case 'b': margin_us = atol(value); break;
+	case 'x': style = atoi(value); break;
+	case 'f': frames = atoi(value); break;
+	case 'e': passes = atoi(value); break;
+	case 'o': prefix = value; break;
+	case 'c':
+	    serial_input.insert(serial_input.end(), value, value + strlen(value));
+	    serial_input.push_back('\n');
+	    break;
+	default:
+	    fprintf(stderr, "unknown option %s\n", argv[i - 1]);
+	    return 2;
+	}
+    }
+
+    margin_limit = margin_us * (CPU_HZ / 1000000);
+
+    char name[256];
+    snprintf(name, sizeof(name), "%s-transitions.csv", prefix);
+    transition_log = fopen(name, "w");
+    if (!transition_log)
+    {
+	perror(name);
+	return 1;
+    }
+    fprintf(transition_log, "time_us,bank,anodes,cathodes\n");
+
+    snprintf(name, sizeof(name), "%s-serial.txt", prefix);
+    serial_log = fopen(name, "w");
+    if (!serial_log)
+    {
+	perror(name);
+	return 1;
+    }
+
+    for (int i = 0; i < TUBES; i++)
+    {
+	tubes[i].min_interval = ~0ULL;
+	tubes[i].spectrum.resize(max_frequency + 1);
+    }
+
+    for (int b = 0; b < BANKS; b++)
+    {
+	last_cathodes[b] = -1;
+	min_margin[b] = ~0ULL;
+    }
+
+    // A blank EEPROM, and the RTC a little before a minute rolls over,
+    // so that the hour and minute tubes change during the run.
+    memset(eeprom_cells, 0xff, sizeof(eeprom_cells));
+    rtc_base = epoch_from_date(2017, 6, 1) + 12 * 3600UL + 34 * 60UL + 55;
+
+    setup();
+
+    if (style >= 0)
+    {
+	journal_set(JOURNAL_TRANSITION, style);
+    }
+    if (frames >= 0)
+    {
+	journal_set(JOURNAL_BANK_FRAMES, frames);
+    }
+    if (passes > 0)
+    {
+	nixie_exercise(0x3f, passes);
+	nixie_parallel_exercise(0x3f, passes);
+	exercise_end = 0;
+    }
+
+    unsigned long long end = (unsigned long long) (seconds * CPU_HZ);
+    serial_input_at = (end > CPU_HZ) ? end - CPU_HZ : 0;
+    while (cycles < end)
+    {
+	loop();
+    }
+
+    fclose(transition_log);
+    fclose(serial_log);
+
+    // Per tube figures.
+    snprintf(name, sizeof(name), "%s-tubes.csv", prefix);
+    FILE *csv = fopen(name, "w");
+    if (!csv)
+    {
+	perror(name);
+	return 1;
+    }
+
+    double run = (double) cycles / CPU_HZ;
+
+    fprintf(csv, "tube,duty,refresh_hz,min_interval_us,max_interval_us,max_dark_us,"
+	    "ghost_us,peak_below_100hz,peak_hz\n");
+    printf("%.1f s simulated, %d bank%s, %s\n\n", run, BANKS, (BANKS > 1) ? "s" : "",
+	   rtc_present ? "on the RTC" : "free running");
+    printf("tube  duty  refresh  interval (us)   dark gap  ghost  flicker <100Hz  peak\n");
+
+    for (int i = 0; i < TUBES; i++)
+    {
+	Tube &t = tubes[i];
+	double duty = (double) t.lit_total / cycles;
+
+	// Modulation depth at each frequency, relative to the average.
+	double peak_low = 0;
+	unsigned int peak_hz = 0;
+	double peak = 0;
+	for (unsigned int f = 1; f <= max_frequency; f++)
+	{
+	    double m = (duty > 0) ? 2 * std::abs(t.spectrum[f]) / run / duty : 0;
+	    if ((f < 100) && (m > peak_low)) peak_low = m;
+	    if (m > peak)
+	    {
+		peak = m;
+		peak_hz = f;
+	    }
+	}
+
+	fprintf(csv, "%d,%.4f,%.1f,%.1f,%.1f,%.1f,%.1f,%.4f,%u\n", i, duty,
+		t.lightings / run, t.min_interval / 16.0, t.max_interval / 16.0,
+		t.max_dark / 16.0, t.ghost_total / 16.0, peak_low, peak_hz);
+
+	printf("%4d %5.1f%% %6.1f Hz %6.0f-%-7.0f %7.0f us %4.0f us %10.1f%% %6u Hz\n", i,
+	       duty * 100, t.lightings / run, t.min_interval / 16.0,
+	       t.max_interval / 16.0, t.max_dark / 16.0, t.ghost_total / 16.0,
+	       peak_low * 100, peak_hz);
+    }
+    fclose(csv);
+
+    printf("\n");
+    for (int b = 0; b < BANKS; b++)
+    {
+	printf("bank %d blanking margin: min %.2f us, %lu cathode changes under %lu us\n", b,
+	       (min_margin[b] == ~0ULL) ? 0.0 : min_margin[b] / 16.0, margin_warnings[b], margin_us);
+    }
+
+    if (passes > 0)
+    {
+	if (exercise_end > 0)
+	{
+	    printf("exercise: %d passes, finished at %.1f s\n", passes, exercise_end / (double) CPU_HZ);
+	}
+	else
+	{
+	    printf("exercise: %d passes, still running at the end\n", passes);
+	}
+    }
+
+    printf("first display: tubes lit %.1f ms after reset\n", first_display_us / 1000.0);
+
+    if (rtc_present)
+    {
+	printf("pps: %lu edges, time on the tubes %.1f us mean, %.1f us max after the edge, "
+	       "%lu times not the RTC's\n", edges,
+	       display_updates ? (double) display_late_total / display_updates / 16.0 : 0.0,
+	       display_late_max / 16.0, display_wrong);
+    }
+    else
+    {
+	printf("free running: counted %lu seconds\n", (unsigned long) (soft_time - 946684800UL));
+    }
+
+    multiplex_timing.print("multiplex");
+    printf("multiplex: longest gap between calls %.2f us\n", multiplex_gap_max / 16.0);
+    printf("port writes: %.2f per call, %.2f of them above the I/O space\n",
+	   multiplex_timing.calls ? (double) port_writes / multiplex_timing.calls : 0.0,
+	   multiplex_timing.calls ? (double) memory_writes / multiplex_timing.calls : 0.0);
+
+    static const char *slot_kinds[2] = { "multiplex per plain slot", "multiplex per transition frame slot" };
+    for (int k = 0; k < 2; k++)
+    {
+	slot_timing[k].print(slot_kinds[k]);
+    }
+    printf("transition frame slots include an assumed %u cycles (%.2f us) for the frame lookup\n",
+	   TRANSITION_FRAME_CYCLES, TRANSITION_FRAME_CYCLES / 16.0);
+
+    parallel_timing.print("parallel cycle");
+    writeall_timing.print("writeall");
+
+    printf("memory (host sizes): %u bytes static RAM, %lu bytes of stack in a call\n",
+	   nixie_ram(), multiplex_stack_max);
+    printf("memory: free RAM, high-water mark, isr depth and per-part RAM are only "
+	   "measured on the Arduino\n");
+
+    // The spectrum.
+    snprintf(name, sizeof(name), "%s-spectrum.csv", prefix);
+    csv = fopen(name, "w");
+    if (!csv)
+    {
+	perror(name);
+	return 1;
+    }
+
+    fprintf(csv, "hz");
+    for (int i = 0; i < TUBES; i++)
+    {
+	fprintf(csv, ",tube%d", i);
+    }
+    fprintf(csv, "\n");
+
+    for (unsigned int f = 1; f <= max_frequency; f++)
+    {
+	fprintf(csv, "%u", f);
+	for (int i = 0; i < TUBES; i++)
+	{
+	    double duty = (double) tubes[i].lit_total / cycles;
+	    double m = (duty > 0) ? 2 * std::abs(tubes[i].spectrum[f]) / run / duty : 0;
+	    fprintf(csv, ",%.5f", m);
+	}
+	fprintf(csv, "\n");
+    }
+    fclose(csv);
+
+    return 0;
+}
@@ -0,0 +1,304 @@
+//-----------------------------------------------------------------------
+// journal-sim.cpp - Simulate EEPROM wear from the settings journal.
+
+// Copyright (c) 2017 Jim Thompson.
+
+//-----------------------------------------------------------------------
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+//-----------------------------------------------------------------------
+// This runs on the host, not the Arduino. Build and run it with
+//
+//     c++ -std=c++11 -O2 -Ihost -o journal-sim host/journal-sim.cpp
+//     ./journal-sim [-d days] [-c changes] [-r resets] [-p ms]
+//
+// It builds journal.cpp unchanged, with the EEPROM stubbed out as an
+// array that counts the writes to each cell, and runs it the way the
+// clock does: the last time is set every second, and journal_poll()
+// is called every few milliseconds (-p, default 2). Each simulated
+// day (-d, default 30) also has a few bursts of setting changes (-c,
+// default 4), each several changes a second apart as if someone were
+// turning a knob, and a few resets (-r, default 1) at random moments,
+// which can cut a record off half written. After each reset the
+// journal is scanned again and its values are checked.
+//
+// A byte takes 3.3 ms to program, so eeprom_is_ready() stays false
+// for 4 ms after each write.
+//
+// At the end it prints the write amplification (EEPROM bytes
+// programmed per value changed, and per record), the writes to the
+// most and least worn cells, and how long the most worn cell would
+// last at that rate, taking a cell as good for 100,000 writes.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unistd.h>
+
+#include "../journal.cpp"
+
+EEPROMClass EEPROM;
+
+static uint8_t cells[E2END + 1];
+static unsigned long cell_writes[E2END + 1];
+
+static unsigned long now_ms = 0;
+static unsigned long ready_ms = 0;
+
+const unsigned long PROGRAM_MS = 4;
+const unsigned long CELL_LIFE = 100000;
+
+unsigned long millis()
+{
+    return now_ms;
+}
+
+unsigned long micros()
+{
+    return now_ms * 1000;
+}
+
+bool eeprom_is_ready()
+{
+    return (long) (now_ms - ready_ms) >= 0;
+}
+
+uint8_t EEPROMClass::read(int address)
+{
+    return cells[address];
+}
+
+void EEPROMClass::write(int address, uint8_t value)
+{
+    cells[address] = value;
+    cell_writes[address]++;
+    ready_ms = now_ms + PROGRAM_MS;
+}
+
+// The latest value set for each key.
+static int32_t latest[JOURNAL_KEYS];
+static bool set[JOURNAL_KEYS];
+
+static void set_value(uint8_t key, int32_t value)
+{
+    journal_set(key, value);
+    latest[key] = value;
+    set[key] = true;
+}
+
+// Throw away everything in RAM, as a reset does, and scan the EEPROM
+// again. The index should come back with no value newer than the one
+// last set, and the last time no older than its write interval allows.
+static bool reset(uint32_t seconds)
+{
+    memset(entries, 0, sizeof(entries));
+    head = 0;
+    next_seq = 0;
+    pending_bytes = RECORD_SIZE;
+    pending_slot = 0;
+    journal_setup();
+
+    for (uint8_t key = 1; key < JOURNAL_KEYS; key++)
+    {
+	int32_t value;
+	if (!journal_get(key, value))
+	{
+	    if ((key == JOURNAL_LAST_TIME) && (seconds > intervals[key] / 1000 + 1))
+	    {
+		printf("after %lu s: no last time\n", (unsigned long) seconds);
+		return false;
+	    }
+	    continue;
+	}
+
+	bool stale = (key == JOURNAL_LAST_TIME) &&
+	    ((uint32_t) value + intervals[key] / 1000 + 1 < (uint32_t) latest[key]);
+	if (!set[key] || (value > latest[key]) || stale)
+	{
+	    printf("after %lu s: key %u read back as %ld, last set to %ld\n",
+		   (unsigned long) seconds, key, (long) value, (long) latest[key]);
+	    return false;
+	}
+
+	// Carry on from what was read back, as the clock would.
+	latest[key] = value;
+    }
+    return true;
+}
+
+// Is any changed key due to be written before the given time?
+static bool due(unsigned long before_ms)
+{
+    for (uint8_t key = 1; key < JOURNAL_KEYS; key++)
+    {
+	if (entries[key].dirty && ((before_ms - entries[key].written_ms) > intervals[key]))
+	{
+	    return true;
+	}
+    }
+    return false;
+}
+
+int main(int argc, char *argv[])
+{
+    unsigned int days = 30;
+    unsigned int changes = 4;
+    unsigned int resets = 1;
+    unsigned int poll_ms = 2;
+
+    int opt;
+    while ((opt = getopt(argc, argv, "d:c:r:p:")) != -1)
+    {
+	switch (opt)
+	{
+	case 'd':
+	    days = atoi(optarg);
+	    break;
+	case 'c':
+	    changes = atoi(optarg);
+	    break;
+	case 'r':
+	    resets = atoi(optarg);
+	    break;
+	case 'p':
+	    poll_ms = atoi(optarg);
+	    break;
+	default:
+	    fprintf(stderr, "usage: %s [-d days] [-c changes] [-r resets] [-p ms]\n", argv[0]);
+	    return 2;
+	}
+    }
+
+    if ((days == 0) || (poll_ms == 0) || (poll_ms > 1000) || (1000 % poll_ms != 0))
+    {
+	fprintf(stderr, "%s: need at least one day, and a poll period that divides 1000 ms\n",
+		argv[0]);
+	return 2;
+    }
+
+    srand(1);
+    memset(cells, 0xff, sizeof(cells));
+    journal_setup();
+
+    const uint32_t START = 1500000000UL;
+    const uint32_t RUN = days * 86400UL;
+
+    // Settle for one write interval of the last time after the run,
+    // so that every change has been written before the final check.
+    const uint32_t SETTLE = intervals[JOURNAL_LAST_TIME] / 1000 + 60;
+
+    unsigned int burst_left = 0;
+    uint8_t burst_key = 0;
+    unsigned int reset_count = 0;
+
+    for (uint32_t second = 0; second < RUN + SETTLE; second++)
+    {
+	if (second < RUN)
+	{
+	    set_value(JOURNAL_LAST_TIME, START + second);
+
+	    if ((burst_left == 0) && ((unsigned long) rand() % 86400 < changes))
+	    {
+		burst_key = JOURNAL_LAST_TIME + 1 + rand() % (JOURNAL_KEYS - JOURNAL_LAST_TIME - 1);
+		burst_left = 1 + rand() % 8;
+	    }
+	    if (burst_left > 0)
+	    {
+		set_value(burst_key, latest[burst_key] + 1);
+		burst_left--;
+	    }
+	}
+
+	// A reset lands somewhere in this second.
+	unsigned long reset_at = 1000;
+	if ((second < RUN) && ((unsigned long) rand() % 86400 < resets))
+	{
+	    reset_at = rand() % 1000;
+	}
+
+	for (unsigned long ms = 0; ms < 1000; ms += poll_ms)
+	{
+	    now_ms = second * 1000UL + ms;
+	    if (ms >= reset_at)
+	    {
+		reset_at = 1000;
+		reset_count++;
+		burst_left = 0;
+		if (!reset(second))
+		{
+		    return 1;
+		}
+	    }
+	    journal_poll();
+
+	    // Nothing more can happen this second once no record is being
+	    // written and no changed key comes due before the next second,
+	    // so skip ahead to save time.
+	    if ((pending_bytes == RECORD_SIZE) && (reset_at == 1000) &&
+		!due(second * 1000UL + 1000))
+	    {
+		break;
+	    }
+	}
+    }
+
+    // One last reset: now everything should have been written.
+    int32_t wanted[JOURNAL_KEYS];
+    memcpy(wanted, latest, sizeof(wanted));
+    if (!reset(RUN + SETTLE))
+    {
+	return 1;
+    }
+    for (uint8_t key = 1; key < JOURNAL_KEYS; key++)
+    {
+	int32_t value;
+	if (set[key] && (!journal_get(key, value) || (value != wanted[key])))
+	{
+	    printf("at the end: key %u is missing or old\n", key);
+	    return 1;
+	}
+    }
+
+    unsigned long most = 0;
+    unsigned long least = cell_writes[0];
+    unsigned long total = 0;
+    for (unsigned int i = 0; i < SLOTS * RECORD_SIZE; i++)
+    {
+	total += cell_writes[i];
+	if (cell_writes[i] > most)
+	{
+	    most = cell_writes[i];
+	}
+	if (cell_writes[i] < least)
+	{
+	    least = cell_writes[i];
+	}
+    }
+
+    printf("days %u, resets %u, slots %u\n", days, reset_count, SLOTS);
+    printf("changes %lu, records %lu, bytes %lu\n", (unsigned long) journal_changes,
+	   (unsigned long) journal_records, (unsigned long) journal_bytes);
+    printf("bytes per change %.3f, bytes per record %.2f\n",
+	   (double) journal_bytes / journal_changes, (double) journal_bytes / journal_records);
+    printf("writes per cell: most %lu, least %lu, mean %.1f\n", most, least,
+	   (double) total / (SLOTS * RECORD_SIZE));
+    if (most > 0)
+    {
+	double per_day = (double) most / days;
+	printf("most worn cell: %.2f writes/day, %.0f years to %lu writes\n",
+	       per_day, CELL_LIFE / per_day / 365.25, CELL_LIFE);
+    }
+
+    return 0;
+}
@@ -0,0 +1,178 @@
+//-----------------------------------------------------------------------
+// make-transitions.cpp - Generate the digit transition tables in
+// Transitions.h.
+
+// Copyright (c) 2017 Jim Thompson.
+
+//-----------------------------------------------------------------------
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+//-----------------------------------------------------------------------
+// This runs on the host, not the Arduino. Build and run it with
+//
+//     c++ -std=c++11 -O2 -o make-transitions host/make-transitions.cpp
+//     ./make-transitions > Transitions.h
+//
+// or, to see what each transition looks like frame by frame,
+//
+//     ./make-transitions -t
+//
+// The multiplexer does no arithmetic on these tables beyond a lookup,
+// so whatever shaping we want (easing, dithering) is done here.
+
+#include <cstdio>
+#include <cstring>
+
+// Frames per transition. A frame is one visit of the multiplexer to
+// the tube, about every 6 ms, so this is a bit under 300 ms.
+static const int FRAMES = 48;
+
+// Flag bits in a frame byte; these must match Transitions.h.
+static const int NEW = 0x40;
+static const int BLANK = 0x80;
+
+// Slot machine rollover: spin once all the way round and on to the
+// new digit, slowing down as it goes (a quadratic ease-out), so that
+// it settles on the new digit for the last few frames. The byte is
+// the offset from the old digit.
+static int rollover(int d, int f)
+{
+    int n2 = FRAMES * FRAMES;
+    int left = FRAMES - f - 1;
+    int pos = ((10 + d) * (n2 - left * left) + n2 - 1) / n2;
+    return pos % 10;
+}
+
+// Crossfade: the new digit is shown on a growing proportion p of the
+// frames and the old digit on a shrinking one, with the tube left dark
+// on the rest so the overall brightness dips by a quarter half way
+// through, the way an incandescent crossfade looks. Each proportion is
+// spread out evenly by sigma-delta modulation. The old digit is offset
+// zero.
+static void crossfade(int *frames)
+{
+    double new_acc = 0;
+    double old_acc = 0;
+
+    for (int f = 0; f < FRAMES; f++)
+    {
+	double p = (f + 1.0) / FRAMES;
+	double dip = 1.0 - p * (1.0 - p);
+
+	new_acc += p * dip;
+	old_acc += (1.0 - p) * dip;
+
+	if (new_acc >= 0.5)
+	{
+	    new_acc -= 1.0;
+	    frames[f] = NEW;
+	}
+	else if (old_acc >= 0.5)
+	{
+	    old_acc -= 1.0;
+	    frames[f] = 0;
+	}
+	else
+	{
+	    frames[f] = BLANK;
+	}
+    }
+
+    // Always finish on the new digit.
+    frames[FRAMES - 1] = NEW;
+}
+
+static void table(const char *suffix, const int *frames)
+{
+    printf("    {");
+    for (int f = 0; f < FRAMES; f++)
+    {
+	printf("%s0x%02x", (f % 12) ? ", " : (f ? ",\n     " : ""), frames[f]);
+    }
+    printf("}%s\n", suffix);
+}
+
+static void generate()
+{
+    printf("// Transitions.h - digit transition tables for nixie.cpp.\n");
+    printf("//\n");
+    printf("// Generated by host/make-transitions.cpp; do not edit.\n\n");
+    printf("#ifndef TRANSITIONS_H\n#define TRANSITIONS_H\n\n");
+    printf("#include <avr/pgmspace.h>\n\n");
+    printf("// Frames per transition.\n");
+    printf("#define TRANSITION_FRAMES %d\n\n", FRAMES);
+    printf("// A frame byte is the offset, 0 to 9, from the old digit to the one\n");
+    printf("// to show, unless one of these bits is set.\n");
+    printf("#define TRANSITION_NEW 0x%02x\t// Show the new digit\n", NEW);
+    printf("#define TRANSITION_BLANK 0x%02x\t// Leave the tube dark\n\n", BLANK);
+
+    printf("// Rollover, indexed by the distance from the old digit to the new,\n");
+    printf("// counting upwards, less one.\n");
+    printf("const uint8_t rollover_frames[9][TRANSITION_FRAMES] PROGMEM = {\n");
+    for (int d = 1; d <= 9; d++)
+    {
+	int frames[FRAMES];
+	char name[16];
+	for (int f = 0; f < FRAMES; f++)
+	{
+	    frames[f] = rollover(d, f);
+	}
+	snprintf(name, sizeof(name), ", // +%d", d);
+	table(name, frames);
+    }
+    printf("};\n\n");
+
+    printf("// Crossfade; the same for every pair of digits.\n");
+    printf("const uint8_t crossfade_frames[TRANSITION_FRAMES] PROGMEM =\n");
+    int frames[FRAMES];
+    crossfade(frames);
+    table(";", frames);
+    printf("\n#endif\n");
+}
+
+// Print what each transition shows, frame by frame, starting from 0.
+static void timeline()
+{
+    for (int d = 1; d <= 9; d++)
+    {
+	printf("rollover 0->%d:  ", d);
+	for (int f = 0; f < FRAMES; f++)
+	{
+	    putchar('0' + rollover(d, f));
+	}
+	putchar('\n');
+    }
+
+    int frames[FRAMES];
+    crossfade(frames);
+    printf("crossfade 0->1: ");
+    for (int f = 0; f < FRAMES; f++)
+    {
+	putchar((frames[f] & NEW) ? '1' : ((frames[f] & BLANK) ? '.' : '0'));
+    }
+    putchar('\n');
+}
+
+int main(int argc, char **argv)
+{
+    if ((argc > 1) && (strcmp(argv[1], "-t") == 0))
+    {
+	timeline();
+    }
+    else
+    {
+	generate();
+    }
+    return 0;
+}
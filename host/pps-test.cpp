@@ -0,0 +1,235 @@
+//-----------------------------------------------------------------------
+// pps-test.cpp - Try the PPS checks and holdover on the host.
+
+// Copyright (c) 2017 Jim Thompson.
+
+//-----------------------------------------------------------------------
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+//-----------------------------------------------------------------------
+// This runs on the host, not the Arduino. Build and run it with
+//
+//     c++ -std=c++11 -O2 -Ihost -o pps-test host/pps-test.cpp
+//
+// It drives ClockSource from Pps.h the way loop() in master-clock.cpp
+// does, with a made-up train of PPS edges for each case below: the
+// edges go to the PpsMonitor as the interrupt would send them, and
+// between them it's polled every millisecond, as loop() does, for the
+// next second on the Arduino's clock or the loss of the signal. Each
+// second that comes is stepped as loop() steps it, counting the time
+// on or reading it from a made-up RTC, whose seconds roll over on the
+// whole seconds of the run.
+//
+// It checks the glitches, missed pulses, holdovers and RTC reads for
+// each case, and that the time is right after every second. The edge
+// times start just short of where micros() wraps, so the wrap is
+// crossed in every case. It prints one line per case and exits with 1
+// if any of them is wrong.
+
+#include <cmath>
+#include <cstdio>
+#include <vector>
+
+#include "../Pps.h"
+
+// Where the runs start: five seconds before micros() wraps, and just
+// before millis() does.
+const unsigned long START_US = 0UL - 5 * PPS_PERIOD;
+const unsigned long START_MS = 0UL - 2000;
+
+struct Case
+{
+    const char *name;
+    std::vector<long> edges;	// Microseconds after the start
+    long set_at;		// When to set the clock, or -1 for never
+    long stall_from;		// When loop() stops polling, or -1
+    long stall_to;		// and when it starts again
+    uint16_t glitches;		// What we expect
+    uint16_t missed;
+    uint16_t holdovers;
+    unsigned int reads;
+};
+
+// A time in seconds, in microseconds.
+static long s(double seconds)
+{
+    return (long) (seconds * PPS_PERIOD);
+}
+
+// Run a case, returning whether it came out as expected.
+static bool run(const Case &c)
+{
+    ClockSource clock;
+    clock.start(START_MS);
+    clock.found(START_US);
+
+    // The time as the clock has it, and what's added to the RTC's
+    // time when the clock is set.
+    uint32_t time = 0;
+    uint32_t offset = 1000;
+
+    unsigned int reads = 0;
+    unsigned int wrong = 0;
+    bool flag = false;
+
+    long end = c.edges.empty() ? 0 : c.edges.back();
+    size_t next = 0;
+    for (long t = 0; t <= end + s(0.5); t += 1000)
+    {
+	unsigned long now_us = START_US + t;
+	unsigned long now_ms = START_MS + t / 1000;
+
+	// What the RTC reads now. Pulses come up to PPS_WINDOW either
+	// side of the rollover, so take the nearest second.
+	uint32_t rtc = offset + (uint32_t) lround((double) t / PPS_PERIOD);
+
+	if ((c.set_at >= 0) && (t == c.set_at))
+	{
+	    offset += 100;
+	    time = rtc + 100;
+	    clock.set(now_us);
+	}
+
+	while ((next < c.edges.size()) && (c.edges[next] <= t))
+	{
+	    if (clock.pps.edge(START_US + c.edges[next]))
+	    {
+		flag = true;
+	    }
+	    next++;
+	}
+
+	if ((c.stall_from >= 0) && (t >= c.stall_from) && (t < c.stall_to))
+	{
+	    continue;
+	}
+
+	bool tick = false;
+	if (!flag)
+	{
+	    tick = (clock.poll(now_us, now_ms) == CLOCK_TICK);
+	}
+
+	if (flag || tick)
+	{
+	    switch (clock.step(flag, tick))
+	    {
+	    case CLOCK_READ:
+		time = offset + (uint32_t) lround((double) t / PPS_PERIOD);
+		reads++;
+		break;
+	    case CLOCK_COUNT:
+		time++;
+		break;
+	    case CLOCK_STAY:
+		break;
+	    }
+
+	    if (time != offset + (uint32_t) lround((double) t / PPS_PERIOD))
+	    {
+		wrong++;
+	    }
+	    flag = false;
+	}
+    }
+
+    bool good = (clock.pps.glitches == c.glitches) && (clock.pps.missed == c.missed) &&
+	(clock.holdovers == c.holdovers) && (reads == c.reads) && (wrong == 0);
+
+    printf("%-22s glitches %u missed %u holdovers %u reads %u wrong times %u%s\n", c.name,
+	   clock.pps.glitches, clock.pps.missed, clock.holdovers, reads, wrong,
+	   good ? "" : "  WRONG");
+    return good;
+}
+
+int main()
+{
+    std::vector<Case> cases;
+
+    // A steady signal, with the jitter we allow for. The RTC is read
+    // on the first pulse only.
+    Case steady = { "steady", {}, -1, -1, -1, 0, 0, 0, 1 };
+    for (int i = 1; i <= 20; i++)
+    {
+	steady.edges.push_back(s(i) + ((i % 2) ? 20000 : -20000));
+    }
+    cases.push_back(steady);
+
+    // Over an hour, it's read again once CLOCK_RESYNC_INTERVAL pulses
+    // have been counted.
+    Case hour = { "resync", {}, -1, -1, -1, 0, 0, 0, 2 };
+    for (unsigned int i = 1; i <= CLOCK_RESYNC_INTERVAL + 10; i++)
+    {
+	hour.edges.push_back(s(i));
+    }
+    cases.push_back(hour);
+
+    // An extra edge between two good ones is a glitch, and so is one
+    // just outside the window.
+    Case glitch = { "glitch", {}, -1, -1, -1, 2, 0, 0, 1 };
+    for (int i = 1; i <= 10; i++)
+    {
+	glitch.edges.push_back(s(i));
+	if (i == 4) glitch.edges.push_back(s(4.3));
+	if (i == 7) glitch.edges.push_back(s(7.94));
+    }
+    cases.push_back(glitch);
+
+    // Pulses that don't come: one, then three in a row. Each gap sends
+    // us into holdover, counting on the Arduino's clock, until the next
+    // edge, when the RTC is read again.
+    Case missed = { "missed", {}, -1, -1, -1, 0, 4, 2, 3 };
+    for (int i = 1; i <= 12; i++)
+    {
+	if ((i != 3) && (i < 6 || i > 8))
+	{
+	    missed.edges.push_back(s(i));
+	}
+    }
+    cases.push_back(missed);
+
+    // The signal stops for six seconds: one holdover, until it's back.
+    Case stops = { "stops", { s(1), s(2), s(3), s(10) }, -1, -1, -1, 0, 6, 1, 2 };
+    cases.push_back(stops);
+
+    // loop() is held up for a second and a half, over the time a pulse
+    // goes missing, so it never sees the signal lost. The missed pulse
+    // has to send it back to the RTC all the same.
+    Case stall = { "missed in a stall", { s(1), s(2), s(4), s(5), s(6) }, -1, s(2.5), s(4.0),
+		   0, 1, 0, 2 };
+    cases.push_back(stall);
+
+    // The clock is set at 3.5 s, restarting the RTC's countdown, so the
+    // edges come half a second out from before. The set rearms the
+    // checks, so that's neither a glitch nor a missed pulse, and the
+    // RTC is read on the next pulse.
+    Case set = { "set", { s(1), s(2), s(3), s(3.6), s(4.6), s(5.6) }, s(3.5), -1, -1,
+		 0, 0, 0, 2 };
+    cases.push_back(set);
+
+    // The RTC's pulses move without the checks being rearmed: the first
+    // edge after is a glitch, so the next is late enough to count as a
+    // miss, and in between we go into holdover for nothing.
+    Case moved = { "moved, not rearmed", { s(1), s(2), s(3), s(3.6), s(4.6), s(5.6) }, -1, -1, -1,
+		   1, 1, 1, 2 };
+    cases.push_back(moved);
+
+    bool good = true;
+    for (size_t i = 0; i < cases.size(); i++)
+    {
+	good = run(cases[i]) && good;
+    }
+
+    return good ? 0 : 1;
+}
@@ -0,0 +1,274 @@
+//-----------------------------------------------------------------------
+// trace-report.cpp - Turn a trace dump from the clock into latency
+// histograms and a chrome://tracing timeline.
+
+// Copyright (c) 2017 Jim Thompson.
+
+//-----------------------------------------------------------------------
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+//-----------------------------------------------------------------------
+// This runs on the host, not the Arduino. Build it with
+//
+//     c++ -std=c++11 -O2 -o trace-report host/trace-report.cpp
+//
+// then capture the serial output after sending the clock a 't' (see
+// Trace.h) and feed it in:
+//
+//     ./trace-report timeline.json < capture.txt
+//
+// A histogram of the time spent in each traced site is printed on
+// standard output, and the timeline is written to the named file,
+// which can be loaded into chrome://tracing or Perfetto. Anything in
+// the capture outside the "trace begin"/"trace end" lines is ignored,
+// so the capture can include the clock's other chatter.
+//
+// Each event carries the low byte of the count of Timer1 wraps along
+// with the timer itself, so gaps of up to about a second between
+// events come out right.
+
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+// Site names, in the order of enum trace_site in Trace.h.
+static const char *site_names[] = {
+    "nixie_multiplex",
+    "isr",
+    "rtc.now",
+    "dial.cycle",
+    "handle_dialed_digit",
+};
+
+static const unsigned int SITES = sizeof(site_names) / sizeof(site_names[0]);
+
+// Timer1 runs at the CPU clock.
+static const double CYCLES_PER_US = 16.0;
+
+// Histogram buckets are powers of two, in cycles: bucket n holds
+// durations from 2^n up to 2^(n+1) - 1 cycles.
+static const unsigned int BUCKETS = 24;
+
+struct Event
+{
+    unsigned int id;
+    unsigned long long cycles;	// Unwrapped timestamp
+};
+
+struct Site
+{
+    std::vector<unsigned long long> open; // Enter times awaiting an exit
+    unsigned long histogram[BUCKETS];
+    unsigned long count;
+    unsigned long long total;
+    unsigned long long min;
+    unsigned long long max;
+};
+
+static unsigned int bucket(unsigned long long cycles)
+{
+    unsigned int b = 0;
+    while ((cycles >>= 1) != 0 && b < BUCKETS - 1)
+    {
+	b++;
+    }
+    return b;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc != 2)
+    {
+	fprintf(stderr, "usage: %s timeline.json < capture.txt\n", argv[0]);
+	return 2;
+    }
+
+    // Read the events, unwrapping the timestamps as we go.
+    std::vector<Event> events;
+    bool in_trace = false;
+    unsigned int last_wraps = 0;
+    unsigned long long base = 0;
+    char line[256];
+
+    while (fgets(line, sizeof(line), stdin))
+    {
+	if (strncmp(line, "trace begin", 11) == 0)
+	{
+	    // Each dump is a separate stretch of time; only keep the
+	    // last one.
+	    in_trace = true;
+	    events.clear();
+	    base = 0;
+	    continue;
+	}
+
+	if (strncmp(line, "trace end", 9) == 0)
+	{
+	    in_trace = false;
+	    continue;
+	}
+
+	if (!in_trace)
+	{
+	    continue;
+	}
+
+	unsigned int id, wraps, stamp;
+	if (sscanf(line, "%u %u %u", &id, &wraps, &stamp) != 3)
+	{
+	    continue;
+	}
+
+	// The wrap count is eight bits; it's the count itself that has
+	// to be unwrapped.
+	if (!events.empty())
+	{
+	    base += (unsigned long long) ((wraps - last_wraps) & 0xff) << 16;
+	}
+	last_wraps = wraps;
+
+	Event e = { id, base + stamp };
+	events.push_back(e);
+    }
+
+    if (events.empty())
+    {
+	fprintf(stderr, "no trace found\n");
+	return 1;
+    }
+
+    FILE *json = fopen(argv[1], "w");
+    if (!json)
+    {
+	perror(argv[1]);
+	return 1;
+    }
+
+    // Pair up enters and exits, and write the timeline. Events are
+    // "B" (begin) and "E" (end) pairs on one thread, so nesting (an
+    // interrupt during the multiplexer, say) shows up as such.
+    Site sites[SITES];
+    for (unsigned int i = 0; i < SITES; i++)
+    {
+	memset(sites[i].histogram, 0, sizeof(sites[i].histogram));
+	sites[i].count = 0;
+	sites[i].total = 0;
+	sites[i].min = ~0ULL;
+	sites[i].max = 0;
+    }
+
+    unsigned long long origin = events[0].cycles;
+    bool first = true;
+
+    fprintf(json, "{\"traceEvents\":[\n");
+
+    for (size_t i = 0; i < events.size(); i++)
+    {
+	unsigned int site = events[i].id >> 1;
+	bool exit = events[i].id & 1;
+
+	if (site >= SITES)
+	{
+	    continue;
+	}
+
+	Site &s = sites[site];
+
+	// The ring starts wherever it starts, so the first event for a
+	// site may be an exit without an enter. Leave it out of both
+	// outputs so the timeline stays balanced.
+	if (exit && s.open.empty())
+	{
+	    continue;
+	}
+
+	double us = (events[i].cycles - origin) / CYCLES_PER_US;
+
+	fprintf(json, "%s{\"name\":\"%s\",\"ph\":\"%s\",\"ts\":%.4f,\"pid\":0,\"tid\":0}",
+		first ? "" : ",\n", site_names[site], exit ? "E" : "B", us);
+	first = false;
+
+	if (!exit)
+	{
+	    s.open.push_back(events[i].cycles);
+	    continue;
+	}
+
+	unsigned long long d = events[i].cycles - s.open.back();
+	s.open.pop_back();
+
+	s.histogram[bucket(d)]++;
+	s.count++;
+	s.total += d;
+	if (d < s.min) s.min = d;
+	if (d > s.max) s.max = d;
+    }
+
+    // Close off anything still open at the end of the ring.
+    double end_us = (events.back().cycles - origin) / CYCLES_PER_US;
+    for (unsigned int i = 0; i < SITES; i++)
+    {
+	for (size_t j = 0; j < sites[i].open.size(); j++)
+	{
+	    fprintf(json, "%s{\"name\":\"%s\",\"ph\":\"E\",\"ts\":%.4f,\"pid\":0,\"tid\":0}",
+		    first ? "" : ",\n", site_names[i], end_us);
+	    first = false;
+	}
+    }
+
+    fprintf(json, "\n],\"displayTimeUnit\":\"ns\"}\n");
+    fclose(json);
+
+    // Print the histograms.
+    printf("%lu events over %.1f us\n", (unsigned long) events.size(), end_us);
+
+    for (unsigned int i = 0; i < SITES; i++)
+    {
+	const Site &s = sites[i];
+
+	if (s.count == 0)
+	{
+	    continue;
+	}
+
+	printf("\n%s: %lu calls, min %llu, mean %llu, max %llu cycles (max %.1f us)\n",
+	       site_names[i], s.count, s.min, s.total / s.count, s.max,
+	       s.max / CYCLES_PER_US);
+
+	unsigned long peak = 0;
+	for (unsigned int b = 0; b < BUCKETS; b++)
+	{
+	    if (s.histogram[b] > peak) peak = s.histogram[b];
+	}
+
+	for (unsigned int b = 0; b < BUCKETS; b++)
+	{
+	    if (s.histogram[b] == 0)
+	    {
+		continue;
+	    }
+
+	    unsigned int bar = (unsigned int) ((s.histogram[b] * 50 + peak - 1) / peak);
+	    printf("  %8lu-%-8lu %6lu ", 1UL << b, (2UL << b) - 1, s.histogram[b]);
+	    for (unsigned int k = 0; k < bar; k++)
+	    {
+		putchar('#');
+	    }
+	    putchar('\n');
+	}
+    }
+
+    return 0;
+}
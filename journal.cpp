@@ -0,0 +1,279 @@
+//-----------------------------------------------------------------------
+// journal.cpp - Wear-leveled record store in EEPROM.
+
+// Copyright (c) 2017 Jim Thompson.
+
+//-----------------------------------------------------------------------
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <Arduino.h>
+#include <EEPROM.h>
+#include <util/crc16.h>
+#include "Journal.h"
+
+// A record is ten bytes: the key, a 32-bit sequence number, a 32-bit
+// value, and a CRC over the other nine. Both numbers are stored low
+// byte first. The sequence number increases by one with every record
+// written, and at a record per cell lifetime it can't wrap before the
+// EEPROM wears out.
+const uint8_t RECORD_SIZE = 10;
+const uint8_t RECORD_CRC = RECORD_SIZE - 1;
+
+const uint16_t SLOTS = (E2END + 1) / RECORD_SIZE;
+
+// The least time, in milliseconds, between writes of each key. A key
+// that changes more often than this has its changes batched up, and
+// only the latest value is written.
+static const uint32_t intervals[JOURNAL_KEYS] = {
+    0,				// (unused)
+    600000UL,			// JOURNAL_LAST_TIME: every ten minutes
+    2000,			// JOURNAL_TIMEZONE
+    2000,			// JOURNAL_TRANSITION
+    2000,			// JOURNAL_BANK_FRAMES
+};
+
+// The RAM index: for each key, its latest value, the slot holding the
+// newest record of it, and whether the value has changed since that
+// record was written.
+struct journal_entry
+{
+    int32_t value;
+    uint32_t seq;		// Sequence number of the newest record
+    uint16_t slot;		// Slot of the newest record
+    bool known;			// The key has a value
+    bool stored;		// The key has a record in EEPROM
+    bool dirty;			// The value needs writing
+    unsigned long written_ms;	// When it was last written
+};
+
+static journal_entry entries[JOURNAL_KEYS];
+
+// The slot the next record goes into, and its sequence number.
+static uint16_t head = 0;
+static uint32_t next_seq = 0;
+
+// The record being written, and how many of its bytes are done. When
+// none is being written, pending_bytes is RECORD_SIZE.
+static uint8_t pending[RECORD_SIZE];
+static uint8_t pending_bytes = RECORD_SIZE;
+static uint16_t pending_slot = 0;
+
+uint32_t journal_changes = 0;
+uint32_t journal_records = 0;
+uint32_t journal_bytes = 0;
+
+uint16_t journal_slots()
+{
+    return SLOTS;
+}
+
+uint16_t journal_ram()
+{
+    return sizeof(intervals) + sizeof(entries) + sizeof(head) + sizeof(next_seq) +
+	sizeof(pending) + sizeof(pending_bytes) + sizeof(pending_slot) +
+	sizeof(journal_changes) + sizeof(journal_records) + sizeof(journal_bytes);
+}
+
+static uint32_t get32(const uint8_t *p)
+{
+    return (uint32_t) p[0] | ((uint32_t) p[1] << 8) |
+	((uint32_t) p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+static void put32(uint8_t *p, uint32_t v)
+{
+    p[0] = v;
+    p[1] = v >> 8;
+    p[2] = v >> 16;
+    p[3] = v >> 24;
+}
+
+static uint8_t crc(const uint8_t *r)
+{
+    uint8_t c = 0;
+    for (uint8_t i = 0; i < RECORD_CRC; i++)
+    {
+	c = _crc8_ccitt_update(c, r[i]);
+    }
+    return c;
+}
+
+void journal_setup()
+{
+    bool any = false;
+    uint32_t newest = 0;
+    uint16_t newest_slot = 0;
+
+    for (uint16_t slot = 0; slot < SLOTS; slot++)
+    {
+	uint8_t r[RECORD_SIZE];
+	for (uint8_t i = 0; i < RECORD_SIZE; i++)
+	{
+	    r[i] = EEPROM.read(slot * RECORD_SIZE + i);
+	}
+
+	// Skip erased, torn and corrupt records.
+	uint8_t key = r[0];
+	if ((key == 0) || (key >= JOURNAL_KEYS) || (crc(r) != r[RECORD_CRC]))
+	{
+	    continue;
+	}
+
+	uint32_t seq = get32(r + 1);
+
+	// Is this the newest record for the key so far?
+	journal_entry &e = entries[key];
+	if (!e.stored || (seq > e.seq))
+	{
+	    e.value = (int32_t) get32(r + 5);
+	    e.seq = seq;
+	    e.slot = slot;
+	    e.known = true;
+	    e.stored = true;
+	}
+
+	// Is it the newest record of all?
+	if (!any || (seq > newest))
+	{
+	    any = true;
+	    newest = seq;
+	    newest_slot = slot;
+	}
+    }
+
+    // Carry on after the newest record.
+    if (any)
+    {
+	head = (newest_slot + 1) % SLOTS;
+	next_seq = newest + 1;
+    }
+}
+
+bool journal_get(uint8_t key, int32_t &value)
+{
+    if ((key >= JOURNAL_KEYS) || !entries[key].known)
+    {
+	return false;
+    }
+
+    value = entries[key].value;
+    return true;
+}
+
+void journal_set(uint8_t key, int32_t value)
+{
+    if ((key == 0) || (key >= JOURNAL_KEYS))
+    {
+	return;
+    }
+
+    journal_entry &e = entries[key];
+    if (e.known && (e.value == value))
+    {
+	return;
+    }
+
+    e.value = value;
+    e.known = true;
+    e.dirty = true;
+    journal_changes++;
+}
+
+// Is the given slot holding the newest record for some key?
+static bool live(uint16_t slot)
+{
+    for (uint8_t key = 1; key < JOURNAL_KEYS; key++)
+    {
+	if (entries[key].stored && (entries[key].slot == slot))
+	{
+	    return true;
+	}
+    }
+    return false;
+}
+
+// Pick a key that's due to be written and start a record for it.
+static void start_record()
+{
+    unsigned long now = millis();
+
+    for (uint8_t key = 1; key < JOURNAL_KEYS; key++)
+    {
+	journal_entry &e = entries[key];
+
+	if (!e.dirty || ((now - e.written_ms) < intervals[key]))
+	{
+	    continue;
+	}
+
+	// Find the next slot that isn't holding a live record. There
+	// are far more slots than keys, so this can't go round forever.
+	while (live(head))
+	{
+	    head = (head + 1) % SLOTS;
+	}
+
+	pending[0] = key;
+	put32(pending + 1, next_seq);
+	e.seq = next_seq;
+	put32(pending + 5, (uint32_t) e.value);
+	pending[RECORD_CRC] = crc(pending);
+
+	pending_slot = head;
+	pending_bytes = 0;
+
+	head = (head + 1) % SLOTS;
+	next_seq++;
+
+	e.dirty = false;
+	e.written_ms = now;
+	journal_records++;
+	return;
+    }
+}
+
+void journal_poll()
+{
+    if (pending_bytes == RECORD_SIZE)
+    {
+	start_record();
+	if (pending_bytes == RECORD_SIZE)
+	{
+	    return;
+	}
+    }
+
+    // Wait for the previous byte to finish programming, rather than
+    // letting the EEPROM library wait for it.
+    if (!eeprom_is_ready())
+    {
+	return;
+    }
+
+    // Write one byte. The CRC goes last, so a record that's cut off
+    // by a reset is recognized as torn.
+    int addr = pending_slot * RECORD_SIZE + pending_bytes;
+    if (EEPROM.read(addr) != pending[pending_bytes])
+    {
+	EEPROM.write(addr, pending[pending_bytes]);
+	journal_bytes++;
+    }
+
+    if (++pending_bytes == RECORD_SIZE)
+    {
+	// The record is complete; it's now the newest for its key.
+	entries[pending[0]].slot = pending_slot;
+	entries[pending[0]].stored = true;
+    }
+}
@@ -17,13 +17,38 @@
 // You should have received a copy of the GNU General Public License
 // along with this program.  If not, see <https://www.gnu.org/licenses/>.
 
+#include <Wire.h>
 #include "RTClib.h"
 #include "Dial.h"
+#include "Alarm.h"
+#include "Trace.h"
+#include "Journal.h"
+#include "Console.h"
+#include "Memory.h"
+#include "Epoch.h"
+#include "Pps.h"
 
 // Declare some external functions we need to use.
 extern void nixie_setup();
 extern void nixie_multiplex();
 extern void nixie_writeall();
+extern void nixie_exercise(uint8_t, uint8_t);
+extern void nixie_parallel_exercise(uint8_t, uint8_t);
+extern void nixie_parallel_cycle();
+extern void nixie_lamp(bool);
+extern void nixie_transition(uint8_t);
+extern void nixie_animate();
+extern void nixie_bank_time(uint8_t, unsigned int, unsigned int, unsigned int);
+extern void nixie_bank_frames(uint8_t, uint8_t);
+extern uint16_t nixie_ram();
+extern uint16_t nixie_parallel_ram();
+extern uint32_t nixie_cathode_on_time(uint8_t, uint8_t);
+extern uint32_t nixie_parallel_cathode_on_time(uint8_t, uint8_t);
+
+// The variables used by the nixie code to hold the time.
+extern unsigned int second;
+extern unsigned int minute;
+extern unsigned int hour;
 
 // Realtime Clock
 RTC_DS3231 rtc;
@@ -37,12 +62,29 @@ const int interrupt_pin = 18;
 volatile byte isr_flag = false;
 
 void handle_dialed_digit(int);
+void handle_alarm_digit(int);
+
+// Where the time is coming from, and the checks on the PPS signal
+// (see Pps.h). We start out free running on the Arduino's own clock,
+// so the tubes can be lit straight away, and switch to the realtime
+// clock as soon as we've found it.
+ClockSource timebase;
 
 // Interrupt Service Routine. This function is called on the rising
 // edge of the PPS (1-Pulse Per Second) signal from the RTC.
 
 void isr()
 {
+    TRACE_ENTER(TRACE_ISR);
+    MEMORY_PROBE(memory_isr_sp, 1);
+
+    // Check that the pulse came when it should have.
+    if (!timebase.pps.edge(micros()))
+    {
+	TRACE_EXIT(TRACE_ISR);
+	return;
+    }
+
     // Set the flag to indicate that the pulse has been received.
     isr_flag = true;
 
@@ -61,6 +103,8 @@ void isr()
     {
 	digitalWrite(led_pin, LOW);
     }
+
+    TRACE_EXIT(TRACE_ISR);
 }
 
 // Set up the ISR and associated I/O pins
@@ -71,22 +115,52 @@ void interrupt_setup()
     attachInterrupt(digitalPinToInterrupt(interrupt_pin), isr, RISING);
 }
 
-// Set up the realtime clock board.
-void rtc_setup()
+// The time, in seconds since 1970. It's counted on once a second,
+// whether the second comes from the PPS signal or the Arduino's clock,
+// and read from the RTC now and then (see Pps.h).
+uint32_t soft_time = 946684800UL; // 2000-01-01 00:00:00
+
+// The time and date we're showing, and, with a second bank of tubes,
+// UTC. These are brought up to soft_time once a second.
+epoch_time clock_time;
+epoch_time utc_time;
+
+// How often, in milliseconds, to look for the RTC while free running,
+// and when we last did.
+const unsigned long RTC_PROBE_INTERVAL = 2000;
+unsigned long rtc_probe_ms = 0;
+bool rtc_probed = false;
+
+// How long after reset, in microseconds, the tubes were first lit.
+unsigned long first_display_us = 0;
+
+// Look for the realtime clock, and set it up if it's there. Returns
+// true if it was found. This is cheap enough to call from loop(): an
+// absent RTC just fails to acknowledge its address.
+bool rtc_probe()
 {
     // The Begin function starts the RTC tracking, and also tells us
-    // whether the RTC is present and connected.
+    // whether the RTC is present and connected. Only complain the
+    // first time; we'll keep trying.
     if (!rtc.begin())
     {
-	Serial.println("Couldn't find RTC");
-	while (1);
+	if (!rtc_probed)
+	{
+	    Serial.println("Couldn't find RTC - free running.");
+	}
+	rtc_probed = true;
+	return false;
     }
 
-    // If we detect that the RTC has lost power, print a warning that
-    // the time may be wonky.
+    rtc_probed = true;
+
+    // If the RTC has lost power its time is meaningless, so give it
+    // ours: the last time we showed before the reset, carried on by
+    // free running since. Print a warning that the time may be wonky.
     if (rtc.lostPower())
     {
 	Serial.println("Realtime clock has lost power - time may be incorrect.");
+	RTC_DS3231::adjust(DateTime(soft_time));
     }
 
     // Set up the PPS signal
@@ -94,6 +168,8 @@ void rtc_setup()
 
     // Advertise that we're ready.
     Serial.println("DS3231 Initialized.");
+
+    return true;
 }
 
 // I/O Pins for the rotary dial.
@@ -104,9 +180,92 @@ const int dial_ground_pin = 24;
 // time.
 RotaryDial dial(dial_sense_pin, 20);
 
+// I/O pins for the alarm. While the alarm set switch is closed,
+// dialed digits are taken as a new alarm (see handle_alarm_digit())
+// rather than as adjustments to the time. The chime pin drives the
+// bell (or buzzer, or whatever is attached).
+const int alarm_set_pin = 26;
+const int chime_pin = 28;
+
+// Actions that an alarm can perform when it goes off.
+const uint8_t ALARM_ACTION_RING = 0;	// Ring the bell for a while
+const uint8_t ALARM_ACTION_CHIME = 1;	// Strike the bell once
+const uint8_t ALARM_ACTION_EXERCISE = 2; // Exercise the tube cathodes
+
+// How many seconds to ring the bell for a full alarm.
+const unsigned int RING_SECONDS = 10;
+
+// When and how to exercise the tube cathodes against poisoning: which
+// tubes (one bit per tube, bit 0 is the tens of hours), how many
+// passes through all ten cathodes, and at what second of the day.
+// Each pass takes about three seconds.
+const uint8_t EXERCISE_TUBES = 0x3f;
+const uint8_t EXERCISE_PASSES = 20;
+const uint32_t EXERCISE_TIME = 3 * 3600UL;
+
+// How many more seconds the bell should stay on. Counted down once a
+// second in loop().
+unsigned int chime_seconds = 0;
+
+void handle_alarm(uint8_t);
+
+// The alarm scheduler.
+AlarmScheduler alarms(handle_alarm);
+
+// The digits of an alarm being entered with the dial, and how many of
+// them we have so far.
+unsigned int alarm_digits[5];
+unsigned int alarm_digit_count = 0;
+
+// What the last digit of an alarm picks: the days it recurs on and
+// what it does. Digit 0 removes the alarms at that time instead.
+struct alarm_kind
+{
+    uint8_t days;
+    uint8_t action;
+};
+
+const alarm_kind alarm_kinds[] = {
+    { 0, 0 },
+    { ALARM_DAILY, ALARM_ACTION_RING },
+    { ALARM_WEEKDAYS, ALARM_ACTION_RING },
+    { ALARM_WEEKENDS, ALARM_ACTION_RING },
+    { ALARM_DAILY, ALARM_ACTION_CHIME },
+    { ALARM_WEEKDAYS, ALARM_ACTION_CHIME },
+    { ALARM_WEEKENDS, ALARM_ACTION_CHIME },
+};
+const unsigned int ALARM_KINDS = sizeof(alarm_kinds) / sizeof(alarm_kinds[0]);
+
 // The main Arduino setup routine
 void setup()
 {
+    // Light the tubes before anything else, so there's something to
+    // look at while the rest of the clock comes up. Until we find the
+    // RTC, we show the free running time, starting from the last time
+    // we showed before the reset. Reading that back from EEPROM takes
+    // a few milliseconds.
+    nixie_setup();
+    journal_setup();
+
+    int32_t last_time;
+    if (journal_get(JOURNAL_LAST_TIME, last_time))
+    {
+	soft_time = last_time;
+    }
+
+    epoch_set(clock_time, soft_time);
+    hour = clock_time.hour;
+    minute = clock_time.minute;
+    second = clock_time.second;
+    nixie_writeall();
+    nixie_multiplex();
+    first_display_us = micros();
+
+    // Settle the animating tubes on the time we're showing, before
+    // loop() applies the stored transition style. Otherwise every tube
+    // not showing 0 plays a transition from 0 on the first second.
+    nixie_animate();
+
     // // Wait for the serial port to initialize.
     // while (!Serial); // for Leonardo/Micro/Zero
 
@@ -115,37 +274,47 @@ void setup()
     Serial.println();
     Serial.println();
     Serial.println("Clock Initializing...");
+    Serial.print("Tubes lit after ");
+    Serial.print(first_display_us);
+    Serial.println(" us.");
     Serial.println();
 
-    // Wait a sec...
-    delay(1000);
+#if TRACE_ENABLE
+    // Start the trace timestamp clock.
+    trace_setup();
+#endif
 
     // Do the ISR setup.
     interrupt_setup();
 
-    // Set up the realtime clock
-    rtc_setup();
+    // Don't let a wedged I2C bus hang us up; the RTC is looked for
+    // from loop() and has to fail quickly if it isn't there.
+#if defined(WIRE_HAS_TIMEOUT)
+    Wire.setWireTimeout(3000, true);
+#endif
 
-    // Set up the nixies
-    nixie_setup();
+    // Start free running. loop() will switch over to the RTC as soon
+    // as it finds it.
+    timebase.start(millis());
+    rtc_probe_ms = millis() - RTC_PROBE_INTERVAL;
 
     // Initialize the I/O pins for the rotary dial. (The Dial object
     // does not do its own setup.
     pinMode(dial_sense_pin, INPUT_PULLUP);
     pinMode(dial_ground_pin, OUTPUT);
     digitalWrite(dial_ground_pin, LOW);
-}
 
-// The variables used by the nixie code to hold the time.
-extern unsigned int second;
-extern unsigned int minute;
-extern unsigned int hour;
+    // Initialize the I/O pins for the alarm.
+    pinMode(alarm_set_pin, INPUT_PULLUP);
+    pinMode(chime_pin, OUTPUT);
+    digitalWrite(chime_pin, LOW);
+
+    // Schedule the nightly cathode exercise.
+    alarms.add(EXERCISE_TIME, ALARM_DAILY, ALARM_ACTION_EXERCISE);
+}
 
-// The local variables we'll use to hold the previous time, for
-// purposes of comparison.
-unsigned char prev_second = 0;
-unsigned char prev_minute = 0;
-unsigned char prev_hour = 0;
+// The previous time, for purposes of comparison.
+uint32_t prev_time = 0;
 
 // The main Arduino event loop
 void loop ()
@@ -160,19 +329,64 @@ void loop ()
     const unsigned long PERIOD = 1000;
 
     // This inner loop runs while waiting for the PPS interrupt to
-    // occur.
+    // occur, or, if we're free running, for the next second to come
+    // around on the Arduino's clock.
+    bool tick = false;
     while (!isr_flag)
     {
+	// Is it time for the next second on the Arduino's clock, or has
+	// the PPS signal stopped?
+	noInterrupts();
+	clock_event event = timebase.poll(micros(), millis());
+	interrupts();
+
+	if (event == CLOCK_TICK)
+	{
+	    tick = true;
+	    break;
+	}
+
+	if (event == CLOCK_LOST)
+	{
+	    Serial.println("PPS lost - holdover.");
+	}
+
+	// Is it time to look for the RTC again?
+	if ((timebase.source == free_running) &&
+	    ((millis() - rtc_probe_ms) >= RTC_PROBE_INTERVAL))
+	{
+	    rtc_probe_ms = millis();
+
+	    if (rtc_probe())
+	    {
+		// Found it. From now on the PPS signal drives us. The
+		// time is read from the RTC on the first pulse, so that
+		// it's in step with the pulses that count it on from
+		// there.
+		noInterrupts();
+		timebase.found(micros());
+		interrupts();
+
+		nixie_lamp(true);
+	    }
+	}
+
 	// If it's time to cycle the multiplexing then do so.
 	if (((TIME) - t) > PERIOD)
 	{
 	    nixie_multiplex();
+	    nixie_parallel_cycle();
 	    t = (TIME);
 	}
 
+	// Write out any settings that have changed.
+	journal_poll();
+
 	// Cycle the dial to check whether it's detected a digit being
 	// dialed.
+	TRACE_ENTER(TRACE_DIAL_CYCLE);
 	unsigned int val = dial.cycle();
+	TRACE_EXIT(TRACE_DIAL_CYCLE);
 
 	// If a digit was dialed, then adjust the clock.
 	if (val > 0)
@@ -185,39 +399,121 @@ void loop ()
 	    Serial.print("You dialed: ");
 	    Serial.println(val);
 
-	    // Call the function that will adjust the time.
-	    handle_dialed_digit(val);
+	    // Call the function that will adjust the time, or the one
+	    // that enters an alarm if the alarm set switch is closed.
+	    if (digitalRead(alarm_set_pin) == LOW)
+	    {
+		handle_alarm_digit(val);
+	    }
+	    else
+	    {
+		alarm_digit_count = 0;
+
+		TRACE_ENTER(TRACE_DIALED_DIGIT);
+		handle_dialed_digit(val);
+		TRACE_EXIT(TRACE_DIALED_DIGIT);
+	    }
 	}
+
+	// Take in any commands from the serial port.
+	console_poll();
     }
 
     // Execution reaches this point when the PPS interrupt is
-    // triggered (once per second).
+    // triggered (once per second), or when the next second is due on
+    // the Arduino's clock.
 
     // Reset the flag.
+    bool pps = isr_flag;
     isr_flag = false;
 
-    // Get the current time.
-    DateTime now = rtc.now();
+    // Get the current time: count the second, or read the RTC if it's
+    // due.
+    clock_source was = timebase.source;
+    noInterrupts();
+    clock_step step = timebase.step(pps, tick);
+    interrupts();
+
+    if ((was == holdover) && (timebase.source == realtime_clock))
+    {
+	nixie_lamp(true);
+	Serial.println("PPS back.");
+    }
+
+    if (step == CLOCK_READ)
+    {
+	TRACE_ENTER(TRACE_RTC_NOW);
+	soft_time = rtc.now().unixtime();
+	TRACE_EXIT(TRACE_RTC_NOW);
+    }
+    else if (step == CLOCK_COUNT)
+    {
+	soft_time++;
+    }
+
+    if (timebase.source != realtime_clock)
+    {
+	// Blink the lamp while free running or in holdover, to show
+	// that the time isn't coming from the RTC.
+	nixie_lamp(soft_time & 1);
+    }
 
-    // Write the time out for the nixie code to see it.
-    hour = now.hour();
-    minute = now.minute();
-    second = now.second();
+    // Bring the time of day up to date; nearly always this is just a
+    // one second tick. Then write it out for the nixie code to see it.
+    epoch_update(clock_time, soft_time);
+    hour = clock_time.hour;
+    minute = clock_time.minute;
+    second = clock_time.second;
 
     // Check to determine whether the time has actually changed. It's
     // possible for a spurious interrupt to occur when the time hasn't
     // changed.
-    if ((hour != prev_hour) || (minute != prev_hour) || (second != prev_second))
+    if (soft_time != prev_time)
     {
 	// Time has changed!
 
 	// First, record the current time
-	prev_second = second;
-	prev_minute = minute;
-	prev_hour = hour;
+	prev_time = soft_time;
 
-	// Next, write the new time to the display
+	// Next, write the new time to the display, and start any digit
+	// transitions on the multiplexed tubes.
 	nixie_writeall();
+
+#if NIXIE_BANKS > 1
+	// The second bank of tubes shows UTC.
+	int32_t zone = 0;
+	journal_get(JOURNAL_TIMEZONE, zone);
+	epoch_update(utc_time, soft_time - zone);
+	nixie_bank_time(1, utc_time.hour, utc_time.minute, utc_time.second);
+
+	// Dim the second bank, if it's been set to.
+	int32_t frames;
+	if (journal_get(JOURNAL_BANK_FRAMES, frames))
+	{
+	    nixie_bank_frames(1, constrain(frames, 0, 8));
+	}
+#endif
+
+	int32_t style;
+	if (journal_get(JOURNAL_TRANSITION, style))
+	{
+	    nixie_transition(style);
+	}
+	nixie_animate();
+
+	// Remember it, in case of a reset. The journal limits how often
+	// this actually goes out to EEPROM.
+	journal_set(JOURNAL_LAST_TIME, soft_time);
+
+	// Keep the bell going, or stop it, as appropriate.
+	if (chime_seconds > 0)
+	{
+	    chime_seconds--;
+	}
+	digitalWrite(chime_pin, (chime_seconds > 0) ? HIGH : LOW);
+
+	// Finally, see whether any alarms are due.
+	alarms.tick(clock_time.sod, clock_time.weekday);
     }
 }
 
@@ -296,15 +592,268 @@ void handle_dialed_digit(int digit)
 	return;
     }
 
-    // Compute an adjustment timespan offset.
-    TimeSpan offset_timespan(offset);
+    // Offset the current time, and write it out to the realtime
+    // clock if there is one. soft_time is kept up to date by the PPS
+    // pulses, so there's no need to read the RTC first.
+    clock_set(soft_time + offset);
+}
 
-    // Get the current time.
-    DateTime now = rtc.now();
+// This function turns dialed digits into a new alarm. Five digits are
+// needed: tens of hours, ones of hours, tens of minutes, ones of
+// minutes, and the kind of alarm:
+//
+//   1, 2, 3    Ring the bell daily, on weekdays, or at weekends
+//   4, 5, 6    Strike the bell once daily, on weekdays, or at weekends
+//   0          Remove the alarms set for that time
+void handle_alarm_digit(int digit)
+{
+    alarm_digits[alarm_digit_count++] = digit;
+
+    // Wait until we have all five digits.
+    if (alarm_digit_count < 5)
+    {
+	return;
+    }
 
-    // Offset the current time by the adjustment offset.
-    DateTime new_now = now + offset_timespan;
+    alarm_digit_count = 0;
+
+    unsigned int h = alarm_digits[0] * 10 + alarm_digits[1];
+    unsigned int m = alarm_digits[2] * 10 + alarm_digits[3];
+    unsigned int kind = alarm_digits[4];
+
+    // Reject nonsense, and start again.
+    if ((h > 23) || (m > 59) || (kind >= ALARM_KINDS))
+    {
+	Serial.println("Invalid alarm.");
+	return;
+    }
+
+    uint32_t sod = h * 3600UL + m * 60UL;
+
+    if (kind == 0)
+    {
+	uint16_t removed = alarms.remove(sod, ALARM_ACTION_RING) +
+	    alarms.remove(sod, ALARM_ACTION_CHIME);
+	Serial.print("Alarms removed: ");
+	Serial.println(removed);
+    }
+    else if (alarms.add(sod, alarm_kinds[kind].days, alarm_kinds[kind].action))
+    {
+	Serial.print("Alarm set for ");
+	Serial.print(h);
+	Serial.print(":");
+	Serial.print(m);
+	Serial.print(", kind ");
+	Serial.println(kind);
+    }
+    else
+    {
+	Serial.println("No room for another alarm.");
+    }
+}
+
+// This function is called by the alarm scheduler when an alarm goes
+// off.
+void handle_alarm(uint8_t action)
+{
+    switch(action)
+    {
+    case ALARM_ACTION_RING:
+	chime_seconds = RING_SECONDS;
+	break;
+
+    case ALARM_ACTION_CHIME:
+	// Leave a longer ring alone if one is in progress.
+	if (chime_seconds == 0)
+	{
+	    chime_seconds = 1;
+	}
+	break;
+
+    case ALARM_ACTION_EXERCISE:
+	nixie_exercise(EXERCISE_TUBES, EXERCISE_PASSES);
+	nixie_parallel_exercise(EXERCISE_TUBES, EXERCISE_PASSES);
+	break;
+    }
+
+    digitalWrite(chime_pin, (chime_seconds > 0) ? HIGH : LOW);
+}
+
+// Set the clock to the given time, in seconds since 1970.
+void clock_set(uint32_t t)
+{
+    soft_time = t;
+
+    if (timebase.source != free_running)
+    {
+	RTC_DS3231::adjust(DateTime(t));
+
+	noInterrupts();
+	timebase.set(micros());
+	interrupts();
+    }
+}
+
+// Set the time of day, leaving the date alone.
+void clock_set_time(uint8_t h, uint8_t m, uint8_t s)
+{
+    epoch_update(clock_time, soft_time);
+    clock_set(soft_time - clock_time.sod + h * 3600UL + m * 60UL + s);
+}
+
+// Set the date, leaving the time of day alone.
+void clock_set_date(uint16_t y, uint8_t m, uint8_t d)
+{
+    epoch_update(clock_time, soft_time);
+    clock_set(epoch_from_date(y, m, d) + clock_time.sod);
+}
+
+// Print out everything we know about how the clock is doing. This is
+// a console_reply, so each piece is at most a line, and the longer
+// lines are split.
+bool clock_print_stats(uint16_t piece)
+{
+    uint16_t glitches;
+    uint16_t missed;
+
+    switch (piece)
+    {
+    case 0:
+	Serial.print("source: ");
+	Serial.println((timebase.source == realtime_clock) ? "rtc" :
+		       ((timebase.source == holdover) ? "holdover" : "free running"));
+	return true;
+
+    case 1:
+	Serial.print("time: ");
+	Serial.println(soft_time);
+	return true;
+
+    case 2:
+	Serial.print("first display us: ");
+	Serial.println(first_display_us);
+	return true;
+
+    case 3:
+	noInterrupts();
+	glitches = timebase.pps.glitches;
+	missed = timebase.pps.missed;
+	interrupts();
+
+	Serial.print("pps glitches/missed/holdovers: ");
+	Serial.print(glitches);
+	Serial.print(' ');
+	Serial.print(missed);
+	Serial.print(' ');
+	Serial.println(timebase.holdovers);
+	return true;
+
+    case 4:
+	Serial.print("alarms: ");
+	Serial.println(alarms.size());
+	return true;
+
+    case 5:
+	Serial.print("journal changes/records: ");
+	Serial.print(journal_changes);
+	Serial.print(' ');
+	Serial.println(journal_records);
+	return true;
+
+    case 6:
+	Serial.print("journal bytes/slots: ");
+	Serial.print(journal_bytes);
+	Serial.print(' ');
+	Serial.println(journal_slots());
+	return true;
+
+    case 7:
+	Serial.print("console max us read/run: ");
+	Serial.print(console_read_max_us);
+	Serial.print(' ');
+	Serial.println(console_run_max_us);
+	return true;
+    }
+
+    return false;
+}
+
+// Print how long each cathode of each tube has been lit since reset,
+// on the multiplexed tubes and on the parallel ones. This is a
+// console_reply, one cathode per piece.
+bool clock_print_cathodes(uint16_t piece)
+{
+    if (piece >= 60)
+    {
+	return false;
+    }
+
+    uint8_t tube = piece / 10;
+    uint8_t cathode = piece % 10;
+
+    Serial.print(tube);
+    Serial.print(' ');
+    Serial.print(cathode);
+    Serial.print(": ");
+    Serial.print(nixie_cathode_on_time(tube, cathode));
+    Serial.print(' ');
+    Serial.println(nixie_parallel_cathode_on_time(tube, cathode));
+    return true;
+}
+
+// Print one part of the clock's static RAM use.
+static void print_ram(const char *name, uint16_t bytes)
+{
+    Serial.print("  ");
+    Serial.print(name);
+    Serial.print(": ");
+    Serial.println(bytes);
+}
+
+// Print out how the clock is using its RAM: the static variables of
+// each part of the clock, then the totals. Whatever isn't listed (the
+// Arduino core, Wire and so on) is put down as other. This is a
+// console_reply, one line per piece.
+bool clock_print_memory(uint16_t piece)
+{
+    uint16_t parts[] = {
+	(uint16_t) sizeof(Serial),
+	(uint16_t) (sizeof(rtc) + sizeof(timebase)),
+	(uint16_t) sizeof(dial),
+	(uint16_t) sizeof(alarms),
+	nixie_ram(),
+	nixie_parallel_ram(),
+	journal_ram(),
+	console_ram(),
+#if TRACE_ENABLE
+	(uint16_t) sizeof(trace_ring),
+#endif
+    };
+    const char *names[] = {
+	"serial", "rtc", "dial", "alarms", "nixie", "parallel", "journal", "console",
+#if TRACE_ENABLE
+	"trace",
+#endif
+    };
+    const uint8_t count = sizeof(parts) / sizeof(parts[0]);
+
+    if (piece < count)
+    {
+	print_ram(names[piece], parts[piece]);
+	return true;
+    }
+
+    if (piece == count)
+    {
+	uint16_t listed = 0;
+	for (uint8_t i = 0; i < count; i++)
+	{
+	    listed += parts[i];
+	}
+	uint16_t total = memory_static();
+	print_ram("other", (total > listed) ? total - listed : 0);
+	return true;
+    }
 
-    // Write the new time out to the realtime clock.
-    RTC_DS3231::adjust(new_now);
+    return memory_report(piece - count - 1);
 }
@@ -0,0 +1,132 @@
+//-----------------------------------------------------------------------
+// memory.cpp - Stack paint and free RAM reporting.
+
+// Copyright (c) 2017 Jim Thompson.
+
+//-----------------------------------------------------------------------
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <Arduino.h>
+#include "Memory.h"
+
+// The start of the static variables; the rest of the linker and
+// malloc symbols are in Memory.h.
+extern uint8_t __data_start;
+
+volatile uint16_t memory_isr_sp = RAMEND;
+volatile uint16_t memory_multiplex_sp = RAMEND;
+volatile uint16_t memory_probe_low = RAMEND;
+
+// Paint everything above the static variables. This runs in .init3,
+// after the stack pointer and zero register have been set up but
+// before anything has been pushed, so it can paint right up to the
+// top of RAM. It mustn't have a stack frame, hence naked; it has no
+// return either, the code simply falls through into .init4.
+void memory_paint() __attribute__((naked, used, section(".init3")));
+
+void memory_paint()
+{
+    // Volatile, so the compiler can't turn the loop into a call to
+    // memset(), which would paint over its own return address.
+    volatile uint8_t *p = &__heap_start;
+
+    while (p <= (uint8_t *) RAMEND)
+    {
+	*p++ = MEMORY_PAINT;
+    }
+}
+
+uint16_t memory_static()
+{
+    return &__heap_start - &__data_start;
+}
+
+uint16_t memory_free()
+{
+    return (uint8_t *) SP - memory_heap_end();
+}
+
+uint16_t memory_min_free()
+{
+    // The heap may have grown over some of the paint; start above it.
+    uint8_t *p = memory_heap_end();
+
+    while ((p <= (uint8_t *) RAMEND) && (*p == MEMORY_PAINT))
+    {
+	p++;
+    }
+
+    // The probes may have painted over where the stack has been, but
+    // they noted how low it went first.
+    noInterrupts();
+    uint8_t *probed = (uint8_t *) memory_probe_low + 1;
+    interrupts();
+    if (probed < p)
+    {
+	p = probed;
+    }
+
+    return p - memory_heap_end();
+}
+
+bool memory_report(uint16_t piece)
+{
+    switch (piece)
+    {
+    case 0:
+	Serial.print("ram: ");
+	Serial.println((uint16_t) ((uint8_t *) RAMEND + 1 - &__data_start));
+	return true;
+
+    case 1:
+	Serial.print("static: ");
+	Serial.println(memory_static());
+	return true;
+
+    case 2:
+	Serial.print("heap: ");
+	Serial.println((uint16_t) (memory_heap_end() - &__heap_start));
+	return true;
+
+    case 3:
+	Serial.print("free now/min: ");
+	Serial.print(memory_free());
+	Serial.print(' ');
+	Serial.println(memory_min_free());
+	return true;
+
+    case 4:
+	// The stack high-water mark is how far down the paint has been
+	// overwritten.
+	Serial.print("stack max: ");
+	Serial.println((uint16_t) ((uint8_t *) RAMEND + 1 - (memory_heap_end() + memory_min_free())));
+	return true;
+
+    case 5:
+    {
+	noInterrupts();
+	uint16_t isr_sp = memory_isr_sp;
+	uint16_t multiplex_sp = memory_multiplex_sp;
+	interrupts();
+
+	Serial.print("stack in isr/multiplex: ");
+	Serial.print(RAMEND - isr_sp);
+	Serial.print(' ');
+	Serial.println(RAMEND - multiplex_sp);
+	return true;
+    }
+    }
+
+    return false;
+}
@@ -21,6 +21,11 @@
 #include <Arduino.h>
 #include "FourBitDigit.h"
 
+// The host simulator's hook for the work done here; see nixie.cpp.
+#ifndef NIXIE_WORK
+#define NIXIE_WORK(work)
+#endif
+
 extern unsigned int second;
 extern unsigned int minute;
 extern unsigned int hour;
@@ -34,6 +39,65 @@ FourBitDigit minute_tens_digit(39, 41, 43, 45);
 FourBitDigit hour_ones_digit(30, 34, 36, 32);
 FourBitDigit hour_tens_digit(31, 33, 35, 37);
 
+// The digit objects in tube order, tens of hours (tube 0) through
+// ones of seconds (tube 5), for the cathode exercise below.
+FourBitDigit *tubes[] = {
+  &hour_tens_digit, &hour_ones_digit,
+  &minute_tens_digit, &minute_ones_digit,
+  &second_tens_digit, &second_ones_digit,
+};
+
+// The value each tube is currently showing.
+uint8_t shown[6];
+
+// Cathode exercise for the parallel tubes; see nixie.cpp for why.
+// These tubes are lit continuously rather than multiplexed, so the
+// run is stepped by nixie_parallel_cycle(), which rewrites at most one
+// tube per call to keep each call short.
+
+// How many calls to nixie_parallel_cycle() each cathode is held for
+// during an exercise run.
+const unsigned int PARALLEL_EXERCISE_CYCLES = 300;
+
+// The tubes being exercised, one bit per tube. Zero when no run is in
+// progress.
+uint8_t parallel_exercise_tubes = 0;
+
+// The cathode being exercised, how long it's been lit, how many more
+// passes through all ten cathodes remain, and which tube to rewrite
+// next.
+uint8_t parallel_exercise_digit = 0;
+unsigned int parallel_exercise_cycles = 0;
+uint8_t parallel_exercise_passes = 0;
+uint8_t parallel_exercise_next = 0;
+
+// How many calls to nixie_parallel_cycle() each cathode of each tube
+// has been lit for since reset.
+uint32_t parallel_cathode_on_cycles[6][10];
+
+void nixie_parallel_exercise(uint8_t tubes, uint8_t passes)
+{
+  parallel_exercise_digit = 0;
+  parallel_exercise_cycles = 0;
+  parallel_exercise_passes = passes;
+  parallel_exercise_next = 0;
+  parallel_exercise_tubes = (passes > 0) ? (tubes & 0x3f) : 0;
+}
+
+uint32_t nixie_parallel_cathode_on_time(uint8_t tube, uint8_t cathode)
+{
+  return parallel_cathode_on_cycles[tube][cathode];
+}
+
+// The RAM taken by the parallel tubes' variables, in bytes.
+uint16_t nixie_parallel_ram()
+{
+  return 6 * sizeof(FourBitDigit) + sizeof(tubes) + sizeof(shown) +
+    sizeof(parallel_exercise_tubes) + sizeof(parallel_exercise_digit) +
+    sizeof(parallel_exercise_cycles) + sizeof(parallel_exercise_passes) +
+    sizeof(parallel_exercise_next) + sizeof(parallel_cathode_on_cycles);
+}
+
 // Write all the values in parallel
 extern void nixie_writeall()
 {
@@ -54,6 +118,24 @@ extern void nixie_writeall()
   hour_ones_digit.setValue(hour_ones);
   hour_tens_digit.setValue(hour_tens);
 
+  // Record what each tube is showing.
+  shown[0] = hour_tens;
+  shown[1] = hour_ones;
+  shown[2] = minute_tens;
+  shown[3] = minute_ones;
+  shown[4] = second_tens;
+  shown[5] = second_ones;
+
+  // Tubes being exercised keep showing the exercise cathode.
+  for (uint8_t i = 0; i < 6; i++)
+  {
+    if (parallel_exercise_tubes & (1 << i))
+    {
+      tubes[i]->setValue(parallel_exercise_digit);
+      shown[i] = parallel_exercise_digit;
+    }
+  }
+
   // Write them all out to their various I/O pins.
   second_ones_digit.writePins();
   second_tens_digit.writePins();
@@ -62,3 +144,61 @@ extern void nixie_writeall()
   hour_ones_digit.writePins();
   hour_tens_digit.writePins();
 }
+
+// This function should be called at the multiplex rate. It keeps the
+// on-time records and steps any exercise run in progress.
+void nixie_parallel_cycle()
+{
+  for (uint8_t i = 0; i < 6; i++)
+  {
+    parallel_cathode_on_cycles[i][shown[i]]++;
+    NIXIE_WORK(PARALLEL_COUNT);
+  }
+
+  if (parallel_exercise_tubes == 0)
+  {
+    return;
+  }
+
+  NIXIE_WORK(PARALLEL_EXERCISE_STEP);
+
+  // Rewrite one tube per call. The next time we get back around to a
+  // tube, it picks up whatever the exercise cathode is by then.
+  uint8_t i = parallel_exercise_next;
+  if (++parallel_exercise_next == 6)
+  {
+    parallel_exercise_next = 0;
+  }
+
+  if (parallel_exercise_tubes & (1 << i))
+  {
+    if (shown[i] != parallel_exercise_digit)
+    {
+      tubes[i]->setValue(parallel_exercise_digit);
+      tubes[i]->writePins();
+      shown[i] = parallel_exercise_digit;
+    }
+  }
+
+  // Time to move on to the next cathode?
+  if (++parallel_exercise_cycles < PARALLEL_EXERCISE_CYCLES)
+  {
+    return;
+  }
+
+  parallel_exercise_cycles = 0;
+
+  if (++parallel_exercise_digit < 10)
+  {
+    return;
+  }
+
+  parallel_exercise_digit = 0;
+
+  if (--parallel_exercise_passes == 0)
+  {
+    // The run is over. Put the time back on the tubes.
+    parallel_exercise_tubes = 0;
+    nixie_writeall();
+  }
+}
@@ -14,125 +14,475 @@ along with this program.  If not, see <http://www.gnu.org/licenses/>.
 *********************************************************************/
 
 #include <Arduino.h>
+#include "Trace.h"
+#include "Transitions.h"
+#include "Boards.h"
+#include "Memory.h"
 
 // This variable tracks which digit we're currently writing out to the
 // display. We cycle through the six digits in order.
-unsigned int index = 0;
+unsigned int index = 1;
 
 // Variables to track the current time.
 unsigned int hour = 0;
 unsigned int minute = 0;
 unsigned int second = 0;
 
-#define UNO 0
-#if defined(UNO) && UNO
+// Whether the hour tens LED is lit.
+bool lamp = true;
 
-// Port and pin mappings for the Arduino Uno. We use these so that we
-// can write values directly to the pins without having to use
-// digitalWrite, which is many times slower.
+// The host simulator (host/flicker.cpp) defines this to see each port
+// write as it happens, and which port it was, since that decides what
+// the write costs. On the Arduino it's nothing.
+#ifndef NIXIE_PORT_WRITTEN
+#define NIXIE_PORT_WRITTEN(port)
+#endif
 
-uint8_t *ports[] = { 
-    &PORTD, &PORTD, &PORTD, &PORTD, &PORTD, &PORTD, &PORTD, &PORTD,
-    &PORTB, &PORTB, &PORTB, &PORTB, &PORTB, &PORTB
-};
+// It also defines this to charge the work done between port writes,
+// which it can't otherwise see: counting the on-time and stepping the
+// exercise run.
+#ifndef NIXIE_WORK
+#define NIXIE_WORK(work)
+#endif
 
-uint8_t masks[] = {
-    0x01, 0x02, 0x04, 0x08, 0x10, 0x20, 0x40, 0x80,
-    0x01, 0x02, 0x04, 0x08, 0x10, 0x20,
-};
+// Inline functions that use the board's pin table (see Boards.h) to
+// turn individual pins on or off. The pin is a template parameter, and
+// the port and mask are constexpr locals, so they have to be worked out
+// at compile time. The table is in PROGMEM, so a call that was left to
+// run would read flash through the data space and get garbage.
+
+template <uint8_t pin> __attribute__((always_inline)) inline void switchPinOn()
+{
+    constexpr uint16_t port = pin_port<pin>();
+    constexpr uint8_t mask = pin_mask<pin>();
+    BOARD_PORT(port) |= mask;
+    NIXIE_PORT_WRITTEN(port);
+}
+
+template <uint8_t pin> __attribute__((always_inline)) inline void switchPinOff()
+{
+    constexpr uint16_t port = pin_port<pin>();
+    constexpr uint8_t mask = pin_mask<pin>();
+    BOARD_PORT(port) &= ~mask;
+    NIXIE_PORT_WRITTEN(port);
+}
+
+void switchDOff()
+{
+    switchPinOff<2>();
+    switchPinOff<3>();
+    switchPinOff<4>();
+    switchPinOff<5>();
+    switchPinOff<6>();
+    switchPinOff<7>();
+}
+
+void setBLowNibble(int value)
+{
+    if (value & 0x01) switchPinOn<8>(); else switchPinOff<8>();
+    if (value & 0x02) switchPinOn<9>(); else switchPinOff<9>();
+    if (value & 0x04) switchPinOn<10>(); else switchPinOff<10>();
+    if (value & 0x08) switchPinOn<11>(); else switchPinOff<11>();
+}
+
+// Extra tube banks. A Mega has the pins to drive a second set of six
+// tubes, say to show UTC alongside local time, or the time in another
+// room. Each bank has its own anodes and its own cathode bus, so both
+// banks can light their tube in the same multiplex slot, and every
+// tube keeps the full one in six duty cycle. Bank 0 is the one on pins
+// 2-11 that shows hour, minute and second; bank 1 shows whatever
+// nixie_bank_time() last gave it, and doesn't do transitions. Set
+// NIXIE_BANKS to 2 in the Makefile to use it.
+#ifndef NIXIE_BANKS
+#define NIXIE_BANKS 1
+#endif
+
+#if (NIXIE_BANKS > 1) && !defined(BOARD_TAG_mega)
+#error "Extra tube banks need the pins of a Mega."
+#endif
+
+#if NIXIE_BANKS > 2
+#error "There are only pins for two tube banks."
+#endif
+
+// The pins of bank 1: the first of six consecutive anode pins, tens of
+// hours first, and the first of four consecutive cathode pins. The
+// anodes are A0-A5 (PORTF) and the cathodes A8-A11 (PORTK), well away
+// from the parallel tubes on pins 30-53.
+const uint8_t BANK1_ANODES = 54;
+const uint8_t BANK1_CATHODES = 62;
+
+// A bank can be dimmed by lighting it on only some frames out of every
+// BANK_CYCLE. Which frames is kept as a bit pattern, with the lit
+// frames spread out as evenly as they'll go, so a dimmed bank doesn't
+// flicker any more than it has to. frame_bit walks through the
+// pattern, one bit per frame. The clock takes bank 1's number of lit
+// frames from the JOURNAL_BANK_FRAMES setting (see Journal.h).
+const uint8_t BANK_CYCLE = 8;
+
+uint8_t bank_pattern[NIXIE_BANKS];
+uint8_t frame_bit = 1;
+
+// The digits each extra bank shows, tens of hours first. (Bank 0's
+// entry isn't used.)
+uint8_t bank_digits[NIXIE_BANKS][6];
+
+template <uint8_t first_anode>
+__attribute__((always_inline)) inline void switchBankOff()
+{
+    switchPinOff<first_anode>();
+    switchPinOff<first_anode + 1>();
+    switchPinOff<first_anode + 2>();
+    switchPinOff<first_anode + 3>();
+    switchPinOff<first_anode + 4>();
+    switchPinOff<first_anode + 5>();
+}
+
+template <uint8_t first_cathode>
+__attribute__((always_inline)) inline void setBankCathodes(uint8_t value)
+{
+    if (value & 0x01) switchPinOn<first_cathode>(); else switchPinOff<first_cathode>();
+    if (value & 0x02) switchPinOn<first_cathode + 1>(); else switchPinOff<first_cathode + 1>();
+    if (value & 0x04) switchPinOn<first_cathode + 2>(); else switchPinOff<first_cathode + 2>();
+    if (value & 0x08) switchPinOn<first_cathode + 3>(); else switchPinOff<first_cathode + 3>();
+}
+
+void nixie_bank_time(uint8_t bank, unsigned int h, unsigned int m, unsigned int s)
+{
+    if ((bank == 0) || (bank >= NIXIE_BANKS))
+    {
+	return;
+    }
+
+    uint8_t *digits = bank_digits[bank];
+    digits[0] = h / 10;
+    digits[1] = h % 10;
+    digits[2] = m / 10;
+    digits[3] = m % 10;
+    digits[4] = s / 10;
+    digits[5] = s % 10;
+}
+
+void nixie_bank_frames(uint8_t bank, uint8_t frames)
+{
+    if (bank >= NIXIE_BANKS)
+    {
+	return;
+    }
+
+    if (frames > BANK_CYCLE)
+    {
+	frames = BANK_CYCLE;
+    }
+
+    uint8_t pattern = 0;
+    for (uint8_t f = 0; f < BANK_CYCLE; f++)
+    {
+	if (((f + 1) * frames / BANK_CYCLE) != (f * frames / BANK_CYCLE))
+	{
+	    pattern |= 1 << f;
+	}
+    }
+    bank_pattern[bank] = pattern;
+}
+
+// Cathode exercise. A nixie tube that shows the same digit for long
+// periods (the tens of hours never shows anything above 2) slowly
+// "poisons" the cathodes that aren't lit, and they stop glowing
+// evenly. The cure is to light every cathode for a while now and
+// then. nixie_exercise() starts a run that steps the chosen tubes
+// through all ten cathodes; the stepping is done a frame at a time
+// inside nixie_multiplex(), so it costs the main loop nothing extra.
+//
+// Tubes are numbered 0 (tens of hours) through 5 (ones of seconds).
+
+// How many frames (full passes through all six tubes) each cathode is
+// held for during an exercise run.
+const unsigned int EXERCISE_FRAMES = 50;
+
+// The tubes being exercised, one bit per tube. Zero when no run is in
+// progress.
+uint8_t exercise_tubes = 0;
+
+// The cathode being exercised, how many frames it's been lit, and how
+// many more passes through all ten cathodes remain.
+uint8_t exercise_digit = 0;
+unsigned int exercise_frames = 0;
+uint8_t exercise_passes = 0;
+
+// How many multiplex slots each cathode of each tube has been lit
+// for since reset. At the 1 ms slot rate these take about seven
+// weeks to wrap.
+uint32_t cathode_on_slots[6][10];
+
+void nixie_exercise(uint8_t tubes, uint8_t passes)
+{
+    exercise_digit = 0;
+    exercise_frames = 0;
+    exercise_passes = passes;
+    exercise_tubes = (passes > 0) ? (tubes & 0x3f) : 0;
+}
+
+bool nixie_exercising()
+{
+    return exercise_tubes != 0;
+}
+
+uint32_t nixie_cathode_on_time(uint8_t tube, uint8_t cathode)
+{
+    return cathode_on_slots[tube][cathode];
+}
+
+// Advance the exercise run by one frame.
+void exercise_frame()
+{
+    if (exercise_tubes == 0)
+    {
+	return;
+    }
+
+    NIXIE_WORK(EXERCISE_FRAME);
+
+    if (++exercise_frames < EXERCISE_FRAMES)
+    {
+	return;
+    }
 
-#else
+    exercise_frames = 0;
 
-// Port and pin mappings for the Arduino Mega 2560.
+    if (++exercise_digit < 10)
+    {
+	return;
+    }
+
+    exercise_digit = 0;
+
+    if (--exercise_passes == 0)
+    {
+	exercise_tubes = 0;
+    }
+}
+
+// Digit transitions. When an hour or minute digit changes, rather than
+// switching straight to the new digit the tube can play a short
+// animation: a slot machine style rollover, or a crossfade. The frames
+// are precomputed (see Transitions.h) and played back one per visit to
+// the tube, so the multiplexer only has to look each one up. The
+// seconds tubes change too often for this to look good, so only tubes
+// 0 to 3 animate.
+
+// Transition styles, as stored under JOURNAL_TRANSITION.
+const uint8_t NIXIE_CUT = 0;
+const uint8_t NIXIE_ROLLOVER = 1;
+const uint8_t NIXIE_CROSSFADE = 2;
+
+uint8_t transition_style = NIXIE_CUT;
 
-volatile uint8_t *ports[] = {
-    &PORTE, &PORTE, &PORTE, &PORTE, &PORTG, &PORTE, &PORTH, &PORTH,
-    &PORTH, &PORTH, &PORTB, &PORTB, &PORTB, &PORTB,
+// Two turns of the digit wheel, so that an offset from a digit can be
+// looked up without taking a remainder.
+const uint8_t wheel[20] = {
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9,
+    0, 1, 2, 3, 4, 5, 6, 7, 8, 9,
 };
 
-uint8_t masks[] = {
-    0x01, 0x02, 0x10, 0x20, 0x20, 0x08, 0x08, 0x10,
-    0x20, 0x40, 0x10, 0x20, 0x40, 0x80,
+// A transition in progress: the next frame, how many frames are left,
+// and the digits we're going from and to.
+struct transition
+{
+    const uint8_t *frames;
+    uint8_t left;
+    uint8_t from;
+    uint8_t to;
 };
 
-#endif
+transition transitions[4];
 
-// Inline functions that use the above port and pin declarations to
-// turn individual pins on or off.
+// The digit each animating tube is settled on, for spotting changes.
+uint8_t settled[4];
 
-__attribute__((always_inline)) inline void switchPinOn(uint8_t pin) { *(ports[pin]) |= masks[pin]; }
-__attribute__((always_inline)) inline void switchPinOff(uint8_t pin) { *(ports[pin]) &= ~masks[pin]; }
+void nixie_transition(uint8_t style)
+{
+    transition_style = style;
+}
 
-void switchDOff()
+// Start a transition on any of the hour and minute tubes that have
+// changed. This should be called each time the time is updated.
+void nixie_animate()
 {
-    switchPinOff(2);
-    switchPinOff(3);
-    switchPinOff(4);
-    switchPinOff(5);
-    switchPinOff(6);
-    switchPinOff(7);
+    unsigned int digits[4] = { hour / 10, hour % 10, minute / 10, minute % 10 };
+
+    for (uint8_t i = 0; i < 4; i++)
+    {
+	if (digits[i] == settled[i])
+	{
+	    continue;
+	}
+
+	transition &tr = transitions[i];
+	tr.from = settled[i];
+	tr.to = digits[i];
+	tr.left = 0;
+
+	if (transition_style == NIXIE_ROLLOVER)
+	{
+	    uint8_t distance = (tr.to + 10 - tr.from) % 10;
+	    tr.frames = rollover_frames[distance - 1];
+	    tr.left = TRANSITION_FRAMES;
+	}
+	else if (transition_style == NIXIE_CROSSFADE)
+	{
+	    tr.frames = crossfade_frames;
+	    tr.left = TRANSITION_FRAMES;
+	}
+
+	settled[i] = digits[i];
+    }
 }
 
-void setBLowNibble(int value)
+// Light one tube with the given value, unless the tube is being
+// exercised, in which case it shows the exercise cathode instead, or
+// is in the middle of a transition, in which case it shows the next
+// frame of that.
+template <uint8_t tube, uint8_t anode_pin>
+__attribute__((always_inline)) inline void lightTube(uint8_t value)
 {
-    if (value & 0x01) switchPinOn(8); else switchPinOff(8);
-    if (value & 0x02) switchPinOn(9); else switchPinOff(9);
-    if (value & 0x04) switchPinOn(10); else switchPinOff(10);
-    if (value & 0x08) switchPinOn(11); else switchPinOff(11);
+    if (!(bank_pattern[0] & frame_bit))
+    {
+	switchDOff();
+	return;
+    }
+
+    if (exercise_tubes & (1 << tube))
+    {
+	value = exercise_digit;
+    }
+    else if ((tube < 4) && transitions[tube].left)
+    {
+	transition &tr = transitions[tube];
+	uint8_t frame = pgm_read_byte(tr.frames++);
+	tr.left--;
+
+	if (frame & TRANSITION_BLANK)
+	{
+	    switchDOff();
+	    return;
+	}
+
+	value = (frame & TRANSITION_NEW) ? tr.to : wheel[tr.from + frame];
+    }
+
+    cathode_on_slots[tube][value]++;
+    NIXIE_WORK(CATHODE_COUNT);
+
+    switchDOff();
+    setBLowNibble(value);
+    switchPinOn<anode_pin>();
+}
+
+// Light the same tube in one of the extra banks. They're exercised
+// along with bank 0.
+template <uint8_t bank, uint8_t tube, uint8_t first_anode, uint8_t first_cathode>
+__attribute__((always_inline)) inline void lightBankTube()
+{
+    switchBankOff<first_anode>();
+
+    if (!(bank_pattern[bank] & frame_bit))
+    {
+	return;
+    }
+
+    uint8_t value = bank_digits[bank][tube];
+    if (exercise_tubes & (1 << tube))
+    {
+	value = exercise_digit;
+    }
+
+    setBankCathodes<first_cathode>(value);
+    switchPinOn<first_anode + tube>();
+}
+
+// Light the given tube in every bank.
+template <uint8_t tube, uint8_t anode_pin>
+__attribute__((always_inline)) inline void lightBanks(uint8_t value)
+{
+    lightTube<tube, anode_pin>(value);
+#if NIXIE_BANKS > 1
+    lightBankTube<1, tube, BANK1_ANODES, BANK1_CATHODES>();
+#endif
 }
 
 void nixie_multiplex()
 {
-    // Turn on the hour tens LED
-    switchPinOn(12);
+    TRACE_ENTER(TRACE_MULTIPLEX);
+    MEMORY_PROBE(memory_multiplex_sp, MEMORY_PROBE_MULTIPLEX);
+
+    // Turn the hour tens LED on or off
+    if (lamp) switchPinOn<12>(); else switchPinOff<12>();
   
     switch(index++)
     {
     case 1:
 	// Tens of hours
-	switchDOff();
-	setBLowNibble(hour / 10);
-	switchPinOn(2);
+	lightBanks<0, 2>(hour / 10);
 	break;
       
     case 2:
 	// Ones of hours
-	switchDOff();
-	setBLowNibble(hour % 10);
-	switchPinOn(3);
+	lightBanks<1, 3>(hour % 10);
 	break;
 
     case 3:
 	// Tens of minutes
-	switchDOff();
-	setBLowNibble(minute / 10);
-	switchPinOn(4);
+	lightBanks<2, 4>(minute / 10);
 	break;
 
     case 4:
 	// Ones of minutes
-	switchDOff();
-	setBLowNibble(minute % 10);
-	switchPinOn(5);
+	lightBanks<3, 5>(minute % 10);
 	break;
 
     case 5:
 	// Tens of seconds
-	switchDOff();
-	setBLowNibble(second / 10);
-	switchPinOn(6);
+	lightBanks<4, 6>(second / 10);
 	break;
 
     case 6:
 	// Ones of seconds
-	switchDOff();
-	setBLowNibble(second % 10);
-	switchPinOn(7);
+	lightBanks<5, 7>(second % 10);
+
+	// That's the end of a frame.
+	exercise_frame();
+
+	frame_bit <<= 1;
+	if (frame_bit == 0)
+	{
+	    frame_bit = 1;
+	}
 
 	/* reset index */
 	index = 1;
 	break;
     }
+
+    TRACE_EXIT(TRACE_MULTIPLEX);
+}
+
+// The RAM taken by the multiplexer's variables and tables, in bytes.
+uint16_t nixie_ram()
+{
+    return sizeof(index) + sizeof(hour) + sizeof(minute) + sizeof(second) +
+	sizeof(lamp) + sizeof(bank_pattern) + sizeof(frame_bit) +
+	sizeof(bank_digits) + sizeof(exercise_tubes) + sizeof(exercise_digit) +
+	sizeof(exercise_frames) + sizeof(exercise_passes) +
+	sizeof(cathode_on_slots) + sizeof(transition_style) +
+	sizeof(wheel) + sizeof(transitions) + sizeof(settled);
+}
+
+// Turn the hour tens LED on or off. The clock blinks it to show that
+// it's keeping time without the RTC.
+void nixie_lamp(bool on)
+{
+    lamp = on;
 }
 
 void nixie_setup()
@@ -162,4 +512,24 @@ void nixie_setup()
     {
 	digitalWrite(i, LOW);
     }
+
+    // Every bank is lit on every frame to start with.
+    for (uint8_t bank = 0; bank < NIXIE_BANKS; bank++)
+    {
+	bank_pattern[bank] = 0xff;
+    }
+
+    // Bank 1's anodes and cathodes.
+#if NIXIE_BANKS > 1
+    for (uint8_t i = 0; i < 6; i++)
+    {
+	pinMode(BANK1_ANODES + i, OUTPUT);
+	digitalWrite(BANK1_ANODES + i, LOW);
+    }
+    for (uint8_t i = 0; i < 4; i++)
+    {
+	pinMode(BANK1_CATHODES + i, OUTPUT);
+	digitalWrite(BANK1_CATHODES + i, LOW);
+    }
+#endif
 }
@@ -0,0 +1,97 @@
+//-----------------------------------------------------------------------
+// trace.cpp - Ring buffer and serial dump for the trace points.
+
+// Copyright (c) 2017 Jim Thompson.
+
+//-----------------------------------------------------------------------
+// This program is free software: you can redistribute it and/or modify
+// it under the terms of the GNU General Public License as published by
+// the Free Software Foundation, either version 3 of the License, or
+// (at your option) any later version.
+
+// This program is distributed in the hope that it will be useful,
+// but WITHOUT ANY WARRANTY; without even the implied warranty of
+// MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+// GNU General Public License for more details.
+
+// You should have received a copy of the GNU General Public License
+// along with this program.  If not, see <https://www.gnu.org/licenses/>.
+
+#include <Arduino.h>
+#include "Trace.h"
+
+#if TRACE_ENABLE
+
+// The ring of recorded events, and the index of the slot the next
+// event goes into (which is also the oldest event, once the ring has
+// filled).
+trace_event trace_ring[TRACE_SIZE];
+volatile uint8_t trace_head = 0;
+
+// Set while the ring is being dumped, so the dump isn't overwritten
+// as it goes out, and when a trigger has frozen it.
+volatile bool trace_frozen = false;
+
+// Timer1 overflows since it was started.
+volatile uint8_t trace_wraps = 0;
+
+volatile uint8_t trace_mask = TRACE_DEFAULT_MASK;
+volatile uint8_t trace_trigger = TRACE_NO_TRIGGER;
+volatile uint8_t trace_after = 0;
+volatile uint8_t trace_countdown = 0;
+
+// Start Timer1 running freely at the CPU clock, and count its wraps.
+void trace_setup()
+{
+    TCCR1A = 0;
+    TCCR1B = _BV(CS10);
+    TIMSK1 = _BV(TOIE1);
+}
+
+ISR(TIMER1_OVF_vect)
+{
+    trace_wraps++;
+}
+
+// Print the ring, oldest event first, one "id wraps stamp" per line,
+// between a "trace begin" and a "trace end". The ring is frozen from
+// the first piece to the last, so it isn't overwritten as it goes out.
+bool trace_dump(uint16_t piece)
+{
+    if (piece == 0)
+    {
+	trace_frozen = true;
+	Serial.println("trace begin");
+	return true;
+    }
+
+    if (piece <= TRACE_SIZE)
+    {
+	const trace_event &e = trace_ring[(trace_head + piece - 1) & (TRACE_SIZE - 1)];
+
+	// Slots that have never been written are all zero; skip them.
+	if ((e.id != 0) || (e.wraps != 0) || (e.stamp != 0))
+	{
+	    Serial.print(e.id);
+	    Serial.print(' ');
+	    Serial.print(e.wraps);
+	    Serial.print(' ');
+	    Serial.println(e.stamp);
+	}
+	return true;
+    }
+
+    if (piece == TRACE_SIZE + 1)
+    {
+	Serial.println("trace end");
+
+	// Start afresh, ready for the trigger to fire again.
+	trace_countdown = 0;
+	trace_frozen = false;
+	return true;
+    }
+
+    return false;
+}
+
+#endif